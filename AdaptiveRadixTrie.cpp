@@ -0,0 +1,602 @@
+#include "Tries.hpp"
+#include "Arena.hpp"
+#include "EdgeLabel.hpp"
+#include "BatchLookup.hpp"
+#include "BulkLoad.hpp"
+#include "ShardedBuild.hpp"
+#include "FrozenTrie.hpp"
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// This trie uses the node layouts of the adaptive radix tree (ART): A node starts as a leaf without any
+// children array and grows through Node4, Node16 and Node48 up to Node256 as children are added, and
+// shrinks back when children are removed. The edges stay compressed exactly like in the other tries, and the
+// nodes refer to their children by arena indices and keep their labels as EdgeLabels like the RadixTrie does.
+class AdaptiveRadixTrie final : public Trie {
+    private:
+        enum NodeType : uint8_t { LEAF, NODE4, NODE16, NODE48, NODE256 };
+
+        // Every layout starts with this header. The children of a node are identified by the first
+        // letter of their edge label, so the layouts only have to store that letter (the key) next to
+        // the arena index of the child.
+        struct Node {
+            EdgeLabel label;
+            NodeType type;
+            bool word_end = false;      // if a word ends at the end of the label (and not only passes through)
+            uint16_t nbr_children = 0;
+
+            Node(EdgeLabel edge_label, NodeType type) : label(edge_label), type(type) {}
+
+            uint8_t key() const { return (uint8_t) label.first(); }
+        };
+
+        struct Leaf : Node {
+            Leaf(EdgeLabel edge_label, bool word_end) : Node(edge_label, LEAF) {
+                this->word_end = word_end;
+            }
+        };
+
+        // Node4 and Node16 keep the keys unsorted in a small array, the child with keys[i] is children[i].
+        struct Node4 : Node {
+            uint8_t keys[4];
+            uint32_t children[4];
+
+            Node4(EdgeLabel edge_label) : Node(edge_label, NODE4) {}
+        };
+
+        struct Node16 : Node {
+            uint8_t keys[16];
+            uint32_t children[16];
+
+            Node16(EdgeLabel edge_label) : Node(edge_label, NODE16) {}
+        };
+
+        // Node48 maps every possible key to a position in the children array. 0 means there is no child,
+        // otherwise the child is stored at children[child_index[key] - 1].
+        struct Node48 : Node {
+            uint8_t child_index[256];
+            uint32_t children[48];
+
+            Node48(EdgeLabel edge_label) : Node(edge_label, NODE48) {
+                std::memset(child_index, 0, sizeof(child_index));
+            }
+        };
+
+        // Index 0 is no node at all (see Arena::index_of), so it marks a missing child.
+        struct Node256 : Node {
+            uint32_t children[256];
+
+            Node256(EdgeLabel edge_label) : Node(edge_label, NODE256) {
+                std::memset(children, 0, sizeof(children));
+            }
+        };
+
+        Arena arena;
+        uint32_t root;
+
+        // The tries that were built by the threads of insert_parallel. Their roots are empty, but their arenas
+        // still hold the nodes that were moved over into this trie, and the nodes are all in the same range.
+        std::vector<std::unique_ptr<AdaptiveRadixTrie>> shards;
+
+        // This function returns the position of the child index whose edge starts with the given letter,
+        // or nullptr if there is no such child. Returning the position instead of the child lets the
+        // caller replace the child, when it has to grow or shrink.
+        static uint32_t* find_child_slot(Node* node, uint8_t key) {
+            switch (node->type)
+            {
+                case LEAF:
+                    return nullptr;
+                case NODE4: {
+                    Node4* n = (Node4*) node;
+                    for (size_t i = 0; i < n->nbr_children; i++)
+                    {
+                        if (n->keys[i] == key) return &n->children[i];
+                    }
+                    return nullptr;
+                }
+                case NODE16: {
+                    Node16* n = (Node16*) node;
+#if defined(__SSE2__)
+                    // Compare the key with all 16 keys at once and only look at the used positions.
+                    __m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8((char) key), _mm_loadu_si128((__m128i*) n->keys));
+                    unsigned mask = _mm_movemask_epi8(cmp) & ((1u << n->nbr_children) - 1);
+                    if (mask == 0) return nullptr;
+                    return &n->children[__builtin_ctz(mask)];
+#else
+                    for (size_t i = 0; i < n->nbr_children; i++)
+                    {
+                        if (n->keys[i] == key) return &n->children[i];
+                    }
+                    return nullptr;
+#endif
+                }
+                case NODE48: {
+                    Node48* n = (Node48*) node;
+                    if (n->child_index[key] == 0) return nullptr;
+                    return &n->children[n->child_index[key] - 1];
+                }
+                case NODE256: {
+                    Node256* n = (Node256*) node;
+                    if (n->children[key] == 0) return nullptr;
+                    return &n->children[key];
+                }
+            }
+            return nullptr;
+        }
+
+        Node* find_child(Node* node, char letter) const {
+            uint32_t* slot = find_child_slot(node, (uint8_t) letter);
+            return slot == nullptr ? nullptr : arena.at_index<Node>(*slot);
+        }
+
+        Node* root_node() const { return arena.at_index<Node>(root); }
+
+        // This function gives the node back to the arena, without touching its children.
+        void free_node(Node* node) {
+            switch (node->type)
+            {
+                case LEAF: arena.destroy((Leaf*) node); break;
+                case NODE4: arena.destroy((Node4*) node); break;
+                case NODE16: arena.destroy((Node16*) node); break;
+                case NODE48: arena.destroy((Node48*) node); break;
+                case NODE256: arena.destroy((Node256*) node); break;
+            }
+        }
+
+        // This function gives the node, its label and all of its descendants back to the arena.
+        void release(Node* node) {
+            for_each_child(node, [this](Node* child) { release(child); });
+            node->label.release(arena);
+            free_node(node);
+        }
+
+        template<class F>
+        void for_each_child(Node* node, F f) const {
+            switch (node->type)
+            {
+                case LEAF:
+                    break;
+                case NODE4:
+                    for (size_t i = 0; i < node->nbr_children; i++) f(arena.at_index<Node>(((Node4*) node)->children[i]));
+                    break;
+                case NODE16:
+                    for (size_t i = 0; i < node->nbr_children; i++) f(arena.at_index<Node>(((Node16*) node)->children[i]));
+                    break;
+                case NODE48:
+                    for (size_t i = 0; i < node->nbr_children; i++) f(arena.at_index<Node>(((Node48*) node)->children[i]));
+                    break;
+                case NODE256:
+                    for (size_t i = 0; i < 256; i++)
+                    {
+                        if (((Node256*) node)->children[i] != 0) f(arena.at_index<Node>(((Node256*) node)->children[i]));
+                    }
+                    break;
+            }
+        }
+
+        // This function creates a node of the given type, moves the label and all children of the old node
+        // into it and frees the old node. The new node takes over the label block of the old one.
+        Node* change_type(Node* node, NodeType type) {
+            Node* new_node;
+            switch (type)
+            {
+                case LEAF: new_node = arena.create<Leaf>(node->label, node->word_end); break;
+                case NODE4: new_node = arena.create<Node4>(node->label); break;
+                case NODE16: new_node = arena.create<Node16>(node->label); break;
+                case NODE48: new_node = arena.create<Node48>(node->label); break;
+                default: new_node = arena.create<Node256>(node->label); break;
+            }
+
+            new_node->word_end = node->word_end;
+            for_each_child(node, [&](Node* child) { insert_child(new_node, child); });
+            free_node(node);
+            return new_node;
+        }
+
+        // This function stores a child in a node, that still has room for it.
+        void insert_child(Node* node, Node* child) {
+            uint8_t key = child->key();
+            uint32_t index = arena.index_of(child);
+            switch (node->type)
+            {
+                case LEAF:
+                    return;
+                case NODE4: {
+                    Node4* n = (Node4*) node;
+                    n->keys[n->nbr_children] = key;
+                    n->children[n->nbr_children] = index;
+                    break;
+                }
+                case NODE16: {
+                    Node16* n = (Node16*) node;
+                    n->keys[n->nbr_children] = key;
+                    n->children[n->nbr_children] = index;
+                    break;
+                }
+                case NODE48: {
+                    Node48* n = (Node48*) node;
+                    n->children[n->nbr_children] = index;
+                    n->child_index[key] = n->nbr_children + 1;
+                    break;
+                }
+                case NODE256:
+                    ((Node256*) node)->children[key] = index;
+                    break;
+            }
+            node->nbr_children++;
+        }
+
+        static size_t capacity(NodeType type) {
+            switch (type)
+            {
+                case LEAF: return 0;
+                case NODE4: return 4;
+                case NODE16: return 16;
+                case NODE48: return 48;
+                default: return 256;
+            }
+        }
+
+        // This function adds a child to the node stored at node_slot. If the node is full, it is replaced
+        // by the next bigger layout.
+        void add_child(uint32_t* node_slot, Node* child) {
+            Node* node = arena.at_index<Node>(*node_slot);
+            if (find_child_slot(node, child->key()) != nullptr) return;
+
+            if (node->nbr_children == capacity(node->type))
+            {
+                node = change_type(node, (NodeType) (node->type + 1));
+                *node_slot = arena.index_of(node);
+            }
+            insert_child(node, child);
+        }
+
+        // This functions delets the child, whoms edge starts with the given letter, from the node stored at
+        // node_slot. If the node gets too empty for its layout, it is replaced by the next smaller one.
+        // The thresholds are below the capacity of the smaller layout, so that a node does not switch back
+        // and forth when a child is added and removed over and over again.
+        void delete_child(uint32_t* node_slot, char letter) {
+            Node* node = arena.at_index<Node>(*node_slot);
+            uint8_t key = (uint8_t) letter;
+            uint32_t* slot = find_child_slot(node, key);
+            if (slot == nullptr) return;
+
+            switch (node->type)
+            {
+                case LEAF:
+                    return;
+                case NODE4:
+                case NODE16: {
+                    // Move the last child into the free position.
+                    uint8_t* keys = node->type == NODE4 ? ((Node4*) node)->keys : ((Node16*) node)->keys;
+                    uint32_t* children = node->type == NODE4 ? ((Node4*) node)->children : ((Node16*) node)->children;
+                    size_t pos = slot - children;
+                    keys[pos] = keys[node->nbr_children - 1];
+                    children[pos] = children[node->nbr_children - 1];
+                    break;
+                }
+                case NODE48: {
+                    Node48* n = (Node48*) node;
+                    size_t pos = n->child_index[key] - 1;
+                    uint32_t last = n->children[n->nbr_children - 1];
+                    n->children[pos] = last;
+                    n->child_index[arena.at_index<Node>(last)->key()] = pos + 1;
+                    n->child_index[key] = 0;
+                    break;
+                }
+                case NODE256:
+                    ((Node256*) node)->children[key] = 0;
+                    break;
+            }
+            node->nbr_children--;
+
+            NodeType smaller = node->type;
+            if (node->type == NODE4 && node->nbr_children == 0) smaller = LEAF;
+            if (node->type == NODE16 && node->nbr_children <= 3) smaller = NODE4;
+            if (node->type == NODE48 && node->nbr_children <= 12) smaller = NODE16;
+            if (node->type == NODE256 && node->nbr_children <= 37) smaller = NODE48;
+
+            if (smaller != node->type) *node_slot = arena.index_of(change_type(node, smaller));
+        }
+
+        // This function splits the node stored at node_slot behind the first length letters of its label. The new
+        // intermediate node gets these letters, which start with the same letter, so it can simply take the place
+        // of the node in its parent. The node keeps the rest of its label and becomes the first child of the
+        // intermediate node, which is returned.
+        Node4* split(uint32_t* node_slot, size_t length) {
+            Node* node = arena.at_index<Node>(*node_slot);
+            Node4* intermediate_node = arena.create<Node4>(node->label.prefix(length, arena));
+            *node_slot = arena.index_of(intermediate_node);
+
+            node->label.remove_prefix(length, arena);
+            insert_child(intermediate_node, node);
+            return intermediate_node;
+        }
+
+        // This function restores the compressed form after a child of the node stored at node_slot was deleted.
+        // A node, that is neither the root nor the end of a word and has only one child left, is merged into
+        // that child: the child gets the joined label and takes the place of the node. It starts with the same
+        // letter, so the parent does not notice. Every other node, that is no word end, still has two children
+        // at least, so it can not become a leave.
+        void merge_with_only_child(uint32_t* node_slot) {
+            Node* node = arena.at_index<Node>(*node_slot);
+            if (node_slot == &root || node->word_end || node->nbr_children != 1) return;
+
+            Node* only_child = nullptr;
+            for_each_child(node, [&](Node* child) { only_child = child; });
+
+            only_child->label.prepend(node->label.view(arena), arena);
+            *node_slot = arena.index_of(only_child);
+            node->label.release(arena);
+            free_node(node);
+        }
+
+        // This constructor makes a shard for insert_parallel. Its arena takes its slabs from the range of the
+        // given arena, so that the threads of insert_parallel do not reserve any address space of their own.
+        AdaptiveRadixTrie(Arena::SharedRange, const Arena& range_owner) : arena(Arena::SharedRange(), range_owner) {
+            root = arena.index_of(arena.create<Leaf>(EdgeLabel(), false));
+        }
+
+    public:
+        AdaptiveRadixTrie(bool huge_pages = false) : arena(huge_pages) {
+            root = arena.index_of(arena.create<Leaf>(EdgeLabel(), false));
+        }
+
+        bool insert(std::string_view elem) override {
+            size_t matched_characters = 0;
+            uint32_t* current_slot = &root;
+            uint32_t* next_slot;
+            Node* current_node = root_node();
+            Node* new_leave_node;
+            Node* next_node;
+            char first_letter;
+
+            while (true)
+            {
+                first_letter = letter_at(elem, matched_characters);
+                next_slot = find_child_slot(current_node, (uint8_t) first_letter);
+
+                if (next_slot == nullptr)
+                {
+                    // There is no edge with the first letter of our unmatched suffix. Therefore, the word is not
+                    // in the trie and we can add it here.
+                    add_child(current_slot, arena.create<Leaf>(EdgeLabel(elem.substr(matched_characters), arena), true));
+                    return 1;
+                }
+                else
+                {
+                    // We now step into the next node and compare the suffix of our word with the edge of that node.
+                    // The suffix is only a view into elem, so nothing gets copied here.
+                    next_node = arena.at_index<Node>(*next_slot);
+                    current_slot = next_slot;
+                    current_node = next_node;
+
+                    size_t lcp = lcp_function(elem.substr(matched_characters), current_node->label.view(arena));
+                    size_t suffix_length = elem.length() - matched_characters;
+                    size_t edge_length = current_node->label.size();
+
+                    if (lcp == suffix_length)
+                    {
+                        // This means, the word ends in the label of this node, so all of its prefixes are in the
+                        // trie already. If it ends inside of the label, the node is split there, so that the end
+                        // of the word gets a node of its own. The word was only in the trie before, if that node
+                        // already was a word end.
+                        if (lcp < edge_length) current_node = split(current_slot, lcp);
+
+                        bool was_word_end = current_node->word_end;
+                        current_node->word_end = true;
+                        return !was_word_end;
+                    }
+                    else if (lcp == edge_length)
+                    {
+                        // This means, we can not yet make a decicion weather or not the word is in the trie.
+                        matched_characters = matched_characters + lcp;
+                    }
+                    else {
+                        // This means, that lcp is smaller then both edge_length and suffix_length, so we now that
+                        // the word is not in the trie and we can insert it here.
+                        //
+                        // We split the next_node at lcp. The two children of the intermediate node are next_node
+                        // and a new leave with our unmatched suffix.
+                        new_leave_node = arena.create<Leaf>(EdgeLabel(elem.substr(matched_characters + lcp), arena), true);
+                        insert_child(split(current_slot, lcp), new_leave_node);
+
+                        return 1;
+                    }
+
+                }
+
+            }
+
+            return 0;
+        }
+
+        bool contains(std::string_view elem) const override {
+            size_t matched_characters = 0;
+            Node* current_node = root_node();
+            Node* next_node;
+            char first_letter;
+
+            while (true)
+            {
+                first_letter = letter_at(elem, matched_characters);
+                next_node = find_child(current_node, first_letter);
+
+                if (next_node == nullptr)
+                {
+                    // There is no edge with the first letter of our unmatched suffix. Therefore, the word is not
+                    // in the trie and we can return false.
+                    return 0;
+                }
+                else
+                {
+                    // We now step into the next node and compare the suffix of our word with the edge of that node.
+                    // The suffix is only a view into elem, so nothing gets copied here.
+                    current_node = next_node;
+
+                    size_t lcp = lcp_function(elem.substr(matched_characters), current_node->label.view(arena));
+                    size_t suffix_length = elem.length() - matched_characters;
+                    size_t edge_length = current_node->label.size();
+
+                    if (lcp == suffix_length)
+                    {
+                        // This means, we reached a leave and therefore the element is contained in the trie.
+                        return 1;
+                    }
+                    else if (lcp == edge_length)
+                    {
+                        // This means, we can not yet make a decicion weather or not the word is contained in the trie.
+                        matched_characters = matched_characters + lcp;
+                    }
+                    else {
+                        // This means, that lcp is smaller then both edge_length and suffix_length, so we now that
+                        // the word is not contained in the trie.
+                        return 0;
+                    }
+
+                }
+
+            }
+
+            return 0;
+        }
+
+        void contains_batch(std::span<const std::string_view> elems, std::vector<bool>& results) const override {
+            batch_contains(*this, root_node(), elems, results,
+                [this](Node* node, char letter) { return find_child(node, letter); },
+                [this](Node* node) { return node->label.view(arena); });
+        }
+
+        void contains_sorted(std::span<const std::string_view> elems, std::vector<bool>& results) const override {
+            sorted_contains(*this, root_node(), elems, results,
+                [this](Node* node, char letter) { return find_child(node, letter); },
+                [this](Node* node) { return node->label.view(arena); });
+        }
+
+        // Every node gets the smallest layout its children fit into. That is also the layout it would have
+        // grown to, if the words were inserted one after another.
+        void bulk_load(std::span<const std::string_view> elems) override {
+            build_sorted<Node>(*this, elems,
+                [this](std::string_view label, std::span<Node* const> children, bool word_end) {
+                    Node* node;
+                    EdgeLabel edge_label(label, arena);
+                    if (children.size() == 0)       node = arena.create<Leaf>(edge_label, word_end);
+                    else if (children.size() <= 4)  node = arena.create<Node4>(edge_label);
+                    else if (children.size() <= 16) node = arena.create<Node16>(edge_label);
+                    else if (children.size() <= 48) node = arena.create<Node48>(edge_label);
+                    else                            node = arena.create<Node256>(edge_label);
+
+                    node->word_end = word_end;
+                    for (Node* child : children) insert_child(node, child);
+                    return node;
+                },
+                [this](std::span<Node* const> children) {
+                    for (Node* child : children) add_child(&root, child);
+                });
+        }
+
+        void insert_parallel(std::span<const std::string_view> elems, size_t nbr_threads) override {
+            std::vector<std::unique_ptr<AdaptiveRadixTrie>> new_shards = build_sharded<AdaptiveRadixTrie>(*this, elems, nbr_threads,
+                [this]() { return std::unique_ptr<AdaptiveRadixTrie>(new AdaptiveRadixTrie(Arena::SharedRange(), arena)); },
+                [this](AdaptiveRadixTrie& shard, char letter) {
+                    Node* child = shard.find_child(shard.root_node(), letter);
+                    shard.delete_child(&shard.root, letter);
+                    add_child(&root, child);
+                });
+            for (std::unique_ptr<AdaptiveRadixTrie>& shard : new_shards) shards.push_back(std::move(shard));
+        }
+
+        std::unique_ptr<FrozenTrie> freeze() const override {
+            return std::make_unique<FrozenTrie>(root_node(),
+                [this](Node* node) { return node->label.view(arena); },
+                [this](Node* node, auto f) { for_each_child(node, f); });
+        }
+
+        // Every layout is counted as a node type of its own. Its slack are the child slots (and keys) it does
+        // not use. The label blocks of the shards are counted as well, like in the RadixTrie.
+        TrieStats stats() const override {
+            TrieStats stats = collect_stats(root_node(),
+                [this](Node* node, auto f) { for_each_child(node, f); },
+                [](Node* node, size_t nbr_children, TrieStats& stats) {
+                    size_t free_slots = node->type == LEAF ? 0 : capacity(node->type) - nbr_children;
+                    switch (node->type)
+                    {
+                        case LEAF: stats.add_node("leaf", Arena::block_bytes(sizeof(Leaf))); break;
+                        case NODE4: stats.add_node("node4", Arena::block_bytes(sizeof(Node4))); free_slots = free_slots * (sizeof(uint8_t) + sizeof(uint32_t)); break;
+                        case NODE16: stats.add_node("node16", Arena::block_bytes(sizeof(Node16))); free_slots = free_slots * (sizeof(uint8_t) + sizeof(uint32_t)); break;
+                        case NODE48: stats.add_node("node48", Arena::block_bytes(sizeof(Node48))); free_slots = free_slots * sizeof(uint32_t); break;
+                        case NODE256: stats.add_node("node256", Arena::block_bytes(sizeof(Node256))); free_slots = free_slots * sizeof(uint32_t); break;
+                    }
+                    stats.child_slack_bytes = stats.child_slack_bytes + free_slots;
+                    stats.nbr_word_ends = stats.nbr_word_ends + node->word_end;
+                });
+            stats.label_bytes = arena.used_label_bytes();
+            for (const std::unique_ptr<AdaptiveRadixTrie>& shard : shards) stats.label_bytes = stats.label_bytes + shard->arena.used_label_bytes();
+            return stats;
+        }
+
+        bool delete_elem(std::string_view elem) override{
+            size_t matched_characters = 0;
+            uint32_t* current_slot = &root;
+            uint32_t* parent_slot;
+            uint32_t* next_slot;
+            Node* current_node = root_node();
+            char first_letter;
+
+            while (true)
+            {
+                first_letter = letter_at(elem, matched_characters);
+                next_slot = find_child_slot(current_node, (uint8_t) first_letter);
+
+                if (next_slot == nullptr)
+                {
+                    // There is no edge with the first letter of our unmatched suffix. Therefore, the word is not
+                    // in the trie and we can return false.
+                    return 0;
+                }
+                else
+                {
+                    // We now step into the next node and compare the suffix of our word with the edge of that node.
+                    // The suffix is only a view into elem, so nothing gets copied here.
+                    parent_slot = current_slot;
+                    current_slot = next_slot;
+                    current_node = arena.at_index<Node>(*next_slot);
+
+                    size_t lcp = lcp_function(elem.substr(matched_characters), current_node->label.view(arena));
+                    size_t suffix_length = elem.length() - matched_characters;
+                    size_t edge_length = current_node->label.size();
+
+                    if (lcp == suffix_length)
+                    {
+                        // This means, we reached a leave and therefore the element was contained in the trie.
+                        // We now have to remove this leave (and everything below it) and then we are done. The
+                        // parent may be left with a single child, and is merged into it.
+                        delete_child(parent_slot, first_letter);
+                        release(current_node);
+                        merge_with_only_child(parent_slot);
+
+                        return 1;
+                    }
+                    else if (lcp == edge_length)
+                    {
+                        // This means, we can not yet make a decicion weather or not the word is in the trie.
+                        matched_characters = matched_characters + lcp;
+                    }
+                    else {
+                        // This means, that lcp is smaller then both edge_length and suffix_length, so we now that
+                        // the word is not contained in the trie.
+                        return 0;
+                    }
+
+                }
+
+            }
+
+            return 0;
+        }
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+// The letters a trie has seen so far, numbered densely from 0. Any byte can be a letter.
+//
+// A node of FixedSizeArrayTrie has one bit for every code (see FixedSize.cpp), so the fewer codes there are, the
+// smaller the nodes. Before a build, the alphabet can learn the letters of all words at once: the letters get
+// their codes by how often they appear, the most frequent first. So with up to 64 letters every node needs a
+// single 64 bit word for its bitmap, and with more (like the bytes of UTF-8 text) the rare ones land in the
+// words behind it, that most nodes never need. A letter that was not learned gets the next free code when it is
+// first inserted.
+class Alphabet {
+    public:
+        static const uint16_t NO_CODE = 0xFFFF;
+        static const size_t NBR_LETTERS = 256;
+
+    private:
+        uint16_t codes[NBR_LETTERS];
+        size_t nbr_codes = 0;
+
+    public:
+        Alphabet() {
+            for (uint16_t& code : codes) code = NO_CODE;
+        }
+
+        // This function returns the code of the letter, or NO_CODE if the letter was never seen.
+        uint16_t code_of(char letter) const { return codes[(uint8_t) letter]; }
+
+        // This function returns the code of the letter and gives it the next free code first, if it has none.
+        uint16_t add(char letter) {
+            uint16_t& code = codes[(uint8_t) letter];
+            if (code == NO_CODE) code = (uint16_t) nbr_codes++;
+            return code;
+        }
+
+        size_t size() const { return nbr_codes; }
+
+        // This function gives codes to all letters of the counts (how often every byte appears), that have none
+        // yet, the most frequent first. The codes given out before stay the same.
+        void learn(const size_t (&counts)[NBR_LETTERS]) {
+            uint16_t letters[NBR_LETTERS];
+            for (size_t i = 0; i < NBR_LETTERS; i++) letters[i] = (uint16_t) i;
+            std::stable_sort(letters, letters + NBR_LETTERS, [&](uint16_t a, uint16_t b) { return counts[a] > counts[b]; });
+
+            for (uint16_t letter : letters)
+            {
+                if (counts[letter] > 0) add((char) letter);
+            }
+        }
+
+        // This function learns the letters of the words. The empty word counts as the 0 byte, since that is the
+        // letter of its edge (see Trie::letter_at).
+        void learn(std::span<const std::string_view> elems) {
+            size_t counts[NBR_LETTERS] = {};
+            for (std::string_view elem : elems)
+            {
+                if (elem.empty()) counts[0]++;
+                for (char letter : elem) counts[(uint8_t) letter]++;
+            }
+            learn(counts);
+        }
+
+        // This function learns the letters of a text with one word per line, like an input file.
+        void learn(std::string_view text) {
+            size_t counts[NBR_LETTERS] = {};
+            for (char letter : text) counts[(uint8_t) letter]++;
+            counts[(uint8_t) '\n'] = 0;
+            learn(counts);
+        }
+};
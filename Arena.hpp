@@ -0,0 +1,346 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <utility>
+#include <sys/mman.h>
+
+// The Arena hands out the memory for the nodes and child arrays of exactly one trie.
+//
+// At construction it reserves one large range of virtual address space (nothing of it is backed by
+// physical memory until it is touched) and cuts blocks from it with a bump pointer. Every block size
+// belongs to a size class, and freed blocks are put on the free list of their class, so the next
+// allocation of that class reuses them instead of growing the trie. When the trie is destroyed the
+// whole range is given back with a single munmap, which is much cheaper than freeing every node.
+//
+// Since every block of the range is a multiple of 16 bytes away from its start, a node can be referred to
+// by a 32 bit index (see index_of) instead of a 64 bit pointer. The edge labels of the nodes are cut from
+// slabs of their own (see append_label) and referred to by their offset in the range. They have size classes
+// and free lists as well, only finer ones, since a label needs no alignment.
+class Arena {
+    public:
+        // Blocks up to 256 bytes are rounded up to a multiple of 16 bytes, larger blocks up to
+        // MAX_CLASS_BYTES to a power of two. Anything bigger than that is taken from malloc.
+        static const size_t GRANULARITY = 16;
+        static const size_t SMALL_LIMIT = 256;
+        static const size_t MAX_CLASS_BYTES = 64 * 1024;
+        static const size_t NBR_SIZE_CLASSES = SMALL_LIMIT / GRANULARITY + 8; // 16 .. 256, 512 .. 64K
+
+        // Labels up to 256 bytes are rounded up to a multiple of 8 bytes, longer ones up to a slab to a power
+        // of two. A label that is longer than a slab gets slabs of its own, which are never given back.
+        static const size_t LABEL_GRANULARITY = 8;
+        static const size_t NBR_LABEL_CLASSES = SMALL_LIMIT / LABEL_GRANULARITY + 13; // 8 .. 256, 512 .. 2M
+
+        // A slab is the unit in which the reserved range is handed to the bump pointer. It is as big
+        // as a huge page, so that a slab can be backed by exactly one huge page if that is requested.
+        static const size_t SLAB_SIZE = 2 * 1024 * 1024;
+        static const size_t DEFAULT_RESERVATION = (size_t) 32 * 1024 * 1024 * 1024; // 32 GiB
+
+        // A 32 bit index can reach 64 GiB in steps of 16 bytes, index 0 is no block at all.
+        static const size_t MAX_RESERVATION = ((size_t) 1 << 32) * GRANULARITY - 2 * SLAB_SIZE;
+
+        // A tag for the constructor, that makes an arena in the range of another one.
+        struct SharedRange {};
+
+    private:
+        struct FreeBlock {
+            FreeBlock* next;
+        };
+
+        // The reserved range. Several arenas can cut their slabs from the same range (one per thread of
+        // insert_parallel), so the next free slab is taken with an atomic counter, and the range is given
+        // back when the last of these arenas is gone.
+        struct Range {
+            char* base = nullptr;
+            size_t size = 0;
+            std::atomic<size_t> next_slab{0};   // offset of the next unused slab from base
+            bool huge_pages = false;
+
+            ~Range() {
+                if (base != nullptr) munmap(base, size);
+            }
+        };
+
+        std::shared_ptr<Range> range;
+        char* cursor = nullptr;         // next unused byte of the current slab
+        char* slab_end = nullptr;       // end of the current slab
+        char* label_cursor = nullptr;   // the same for the current slab of edge labels
+        char* label_slab_end = nullptr;
+
+        FreeBlock* free_lists[NBR_SIZE_CLASSES] = {};
+        FreeBlock* label_free_lists[NBR_LABEL_CLASSES] = {};
+        size_t used = 0;
+        size_t label_bytes = 0;
+        size_t nbr_slabs = 0;
+
+        static size_t size_class(size_t bytes) {
+            if (bytes <= SMALL_LIMIT) return bytes == 0 ? 0 : (bytes - 1) / GRANULARITY;
+
+            size_t size_class = SMALL_LIMIT / GRANULARITY;
+            size_t class_bytes = 2 * SMALL_LIMIT;
+            while (class_bytes < bytes)
+            {
+                class_bytes = class_bytes * 2;
+                size_class++;
+            }
+            return size_class;
+        }
+
+        static size_t class_size(size_t size_class) {
+            if (size_class < SMALL_LIMIT / GRANULARITY) return (size_class + 1) * GRANULARITY;
+            return (2 * SMALL_LIMIT) << (size_class - SMALL_LIMIT / GRANULARITY);
+        }
+
+        // The label classes, like the ones of the blocks. A label has at least one letter.
+        static size_t label_class(size_t length) {
+            if (length <= SMALL_LIMIT) return length == 0 ? 0 : (length - 1) / LABEL_GRANULARITY;
+
+            size_t label_class = SMALL_LIMIT / LABEL_GRANULARITY;
+            size_t class_bytes = 2 * SMALL_LIMIT;
+            while (class_bytes < length)
+            {
+                class_bytes = class_bytes * 2;
+                label_class++;
+            }
+            return label_class;
+        }
+
+        static size_t label_class_size(size_t label_class) {
+            if (label_class < SMALL_LIMIT / LABEL_GRANULARITY) return (label_class + 1) * LABEL_GRANULARITY;
+            return (2 * SMALL_LIMIT) << (label_class - SMALL_LIMIT / LABEL_GRANULARITY);
+        }
+
+        // This function takes enough fresh slabs of the reserved range for the given number of bytes.
+        char* take_slabs(size_t bytes) {
+            size_t slabs_bytes = (bytes + SLAB_SIZE - 1) / SLAB_SIZE * SLAB_SIZE;
+            size_t offset = range->next_slab.fetch_add(slabs_bytes, std::memory_order_relaxed);
+            if (offset + slabs_bytes > range->size) throw std::bad_alloc();
+
+            char* slab = range->base + offset;
+            if (range->huge_pages) madvise(slab, slabs_bytes, MADV_HUGEPAGE);
+            nbr_slabs = nbr_slabs + slabs_bytes / SLAB_SIZE;
+            return slab;
+        }
+
+        // This function moves the bump pointer into a fresh slab of the reserved range.
+        void next_slab() {
+            cursor = take_slabs(SLAB_SIZE);
+            slab_end = cursor + SLAB_SIZE;
+        }
+
+    public:
+        explicit Arena(bool use_huge_pages = false, size_t reservation = DEFAULT_RESERVATION) : range(std::make_shared<Range>()) {
+            range->huge_pages = use_huge_pages;
+
+            // The reservation is only address space, but some systems limit that as well. In that case
+            // we try again with half the size until we get something.
+            if (reservation > MAX_RESERVATION) reservation = MAX_RESERVATION;
+            reservation = (reservation + SLAB_SIZE - 1) / SLAB_SIZE * SLAB_SIZE;
+            while (reservation >= SLAB_SIZE)
+            {
+                // We reserve one slab more than we need, so that the first slab can start at a huge
+                // page boundary.
+                void* ptr = mmap(nullptr, reservation + SLAB_SIZE, PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+                if (ptr != MAP_FAILED)
+                {
+                    range->base = (char*) ptr;
+                    range->size = reservation + SLAB_SIZE;
+                    break;
+                }
+                reservation = reservation / 2;
+            }
+            if (range->base == nullptr) throw std::bad_alloc();
+
+            range->next_slab = (((uintptr_t) range->base + SLAB_SIZE - 1) / SLAB_SIZE * SLAB_SIZE) - (uintptr_t) range->base;
+        }
+
+        // This constructor makes an arena with free lists and slabs of its own, that takes its slabs from the
+        // range of other. So the indices and label offsets of both arenas mean the same. Each of the two may
+        // be used by another thread.
+        Arena(SharedRange, const Arena& other) : range(other.range) {}
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        // This function returns a block of at least the given size, aligned to 16 bytes.
+        void* allocate(size_t bytes) {
+            if (bytes > MAX_CLASS_BYTES) return std::malloc(bytes);
+
+            size_t idx = size_class(bytes);
+            size_t block_size = class_size(idx);
+            used += block_size;
+
+            FreeBlock* block = free_lists[idx];
+            if (block != nullptr)
+            {
+                free_lists[idx] = block->next;
+                return block;
+            }
+
+            if (cursor + block_size > slab_end) next_slab();
+            void* ptr = cursor;
+            cursor = cursor + block_size;
+            return ptr;
+        }
+
+        // This function puts a block on the free list of its size class. The size has to be the one
+        // that was used to allocate the block.
+        void deallocate(void* ptr, size_t bytes) {
+            if (ptr == nullptr) return;
+            if (bytes > MAX_CLASS_BYTES)
+            {
+                std::free(ptr);
+                return;
+            }
+
+            size_t idx = size_class(bytes);
+            used -= class_size(idx);
+
+            FreeBlock* block = (FreeBlock*) ptr;
+            block->next = free_lists[idx];
+            free_lists[idx] = block;
+        }
+
+        // This function resizes a block. As long as the new size stays in the same size class, the
+        // block does not move at all.
+        void* reallocate(void* ptr, size_t old_bytes, size_t new_bytes) {
+            if (ptr == nullptr) return new_bytes == 0 ? nullptr : allocate(new_bytes);
+            if (new_bytes == 0)
+            {
+                deallocate(ptr, old_bytes);
+                return nullptr;
+            }
+            if (old_bytes <= MAX_CLASS_BYTES && new_bytes <= MAX_CLASS_BYTES
+                && size_class(old_bytes) == size_class(new_bytes))
+            {
+                return ptr;
+            }
+
+            void* new_ptr = allocate(new_bytes);
+            std::memcpy(new_ptr, ptr, old_bytes < new_bytes ? old_bytes : new_bytes);
+            deallocate(ptr, old_bytes);
+            return new_ptr;
+        }
+
+        template<class T, class... Args>
+        T* create(Args&&... args) {
+            return new (allocate(sizeof(T))) T(std::forward<Args>(args)...);
+        }
+
+        template<class T>
+        void destroy(T* ptr) {
+            ptr->~T();
+            deallocate(ptr, sizeof(T));
+        }
+
+        // This function returns the 32 bit index of a block of at most MAX_CLASS_BYTES (which always comes
+        // from the reserved range). The index of nullptr is 0.
+        uint32_t index_of(const void* ptr) const {
+            if (ptr == nullptr) return 0;
+            return (uint32_t) (((const char*) ptr - range->base) / GRANULARITY + 1);
+        }
+
+        template<class T>
+        T* at_index(uint32_t index) const {
+            if (index == 0) return nullptr;
+            return (T*) (range->base + (size_t) (index - 1) * GRANULARITY);
+        }
+
+        // This function returns the offset of a block for a label of the given length. A freed label of the
+        // same class is used again, otherwise the label is cut from the current label slab.
+        uint64_t allocate_label(size_t length) {
+            if (length > SLAB_SIZE)
+            {
+                label_bytes = label_bytes + length;
+                return take_slabs(length) - range->base;
+            }
+
+            size_t idx = label_class(length);
+            size_t block_size = label_class_size(idx);
+            label_bytes = label_bytes + block_size;
+
+            FreeBlock* block = label_free_lists[idx];
+            if (block != nullptr)
+            {
+                label_free_lists[idx] = block->next;
+                return (char*) block - range->base;
+            }
+
+            if (label_cursor + block_size > label_slab_end)
+            {
+                label_cursor = take_slabs(SLAB_SIZE);
+                label_slab_end = label_cursor + SLAB_SIZE;
+            }
+            char* ptr = label_cursor;
+            label_cursor = label_cursor + block_size;
+            return ptr - range->base;
+        }
+
+        // This function puts the block of a label on the free list of its class. The length has to be the one
+        // it was allocated for (or one of the same class, see remove_label_prefix).
+        void deallocate_label(uint64_t offset, size_t length) {
+            if (length > SLAB_SIZE)
+            {
+                label_bytes = label_bytes - length;
+                return;
+            }
+
+            size_t idx = label_class(length);
+            label_bytes = label_bytes - label_class_size(idx);
+
+            FreeBlock* block = (FreeBlock*) (range->base + offset);
+            block->next = label_free_lists[idx];
+            label_free_lists[idx] = block;
+        }
+
+        // This function copies an edge label (given in one or two parts) into a new label block and returns its
+        // offset.
+        uint64_t append_label(std::string_view first, std::string_view second = std::string_view()) {
+            uint64_t offset = allocate_label(first.length() + second.length());
+            char* ptr = range->base + offset;
+            std::memcpy(ptr, first.data(), first.length());
+            if (!second.empty()) std::memcpy(ptr + first.length(), second.data(), second.length());
+            return offset;
+        }
+
+        // This function removes the first n letters of the label at offset and returns its new offset. As long
+        // as the shorter label stays in the same class, the letters are only moved to the front of its block.
+        uint64_t remove_label_prefix(uint64_t offset, size_t length, size_t n) {
+            char* ptr = range->base + offset;
+            if (length <= SLAB_SIZE && label_class(length) == label_class(length - n))
+            {
+                std::memmove(ptr, ptr + n, length - n);
+                return offset;
+            }
+
+            uint64_t new_offset = append_label(std::string_view(ptr + n, length - n));
+            deallocate_label(offset, length);
+            return new_offset;
+        }
+
+        const char* label_at(uint64_t offset) const { return range->base + offset; }
+
+        bool uses_huge_pages() const { return range->huge_pages; }
+
+        // Bytes in blocks that are currently handed out (rounded up to their size class). A trie that was
+        // built by several threads has one arena per thread (see ShardedBuild.hpp), and a block may be given
+        // back to another of them than the one it came from. Then only the sum over all of them is meaningful.
+        size_t used_bytes() const { return used; }
+
+        // Bytes in label blocks that are currently handed out (rounded up to their class). Like used_bytes, a
+        // label may be given back to another arena of the same range, so then only the sum is meaningful.
+        size_t used_label_bytes() const { return label_bytes; }
+
+        // The bytes a block of the given size really takes, after rounding it up to its size class.
+        static size_t block_bytes(size_t bytes) { return bytes == 0 ? 0 : class_size(size_class(bytes)); }
+
+        // Bytes of the reserved range that have been touched so far.
+        size_t slab_bytes() const { return nbr_slabs * SLAB_SIZE; }
+};
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "Tries.hpp"
+#include "RadixSort.hpp"
+
+// This function answers contains for a whole batch of words at once. It works for every trie whose nodes
+// can be searched with find_child(node, letter) and whose edge labels are returned by label_of(node).
+//
+// A single contains is a chain of dependent loads: find the child, load it, compare its label, find the
+// next child, ... Every step waits for the memory of the node before. Here up to MAX_GROUP lookups are
+// running at the same time as small state machines. Each one does one step, prefetches the node it needs
+// next and then lets the next lookup do its step. When it gets its turn again, the node is (hopefully)
+// already in the cache. So the waiting times of the lookups overlap instead of adding up.
+template<class Node, class FindChild, class LabelOf>
+void batch_contains(const Trie& trie, Node* root, std::span<const std::string_view> elems, std::vector<bool>& results,
+                    FindChild find_child, LabelOf label_of) {
+    static const size_t MAX_GROUP = 16;
+
+    // The state of one running lookup. node is the node whose label has to be compared next.
+    struct Lookup {
+        size_t index;
+        size_t matched_characters;
+        Node* node;
+    };
+
+    Lookup group[MAX_GROUP];
+    size_t group_size = 0;
+    size_t next_index = 0;
+
+    results.resize(elems.size());
+
+    // This function starts the lookup of the next word in the given position of the group. Words that
+    // already end at the root are answered right away. It returns false if there is no word left.
+    auto start_lookup = [&](Lookup& lookup) {
+        while (next_index < elems.size())
+        {
+            size_t index = next_index++;
+            Node* node = find_child(root, trie.letter_at(elems[index], 0));
+            if (node == nullptr)
+            {
+                results[index] = 0;
+                continue;
+            }
+            __builtin_prefetch(node);
+            lookup = Lookup{index, 0, node};
+            return true;
+        }
+        return false;
+    };
+
+    while (group_size < MAX_GROUP && start_lookup(group[group_size])) group_size++;
+
+    while (group_size > 0)
+    {
+        for (size_t i = 0; i < group_size; i++)
+        {
+            Lookup& lookup = group[i];
+            std::string_view elem = elems[lookup.index];
+
+            // This is one step of the loop in contains.
+            std::string_view edge_label = label_of(lookup.node);
+            size_t lcp = trie.lcp_function(elem.substr(lookup.matched_characters), edge_label);
+            size_t suffix_length = elem.length() - lookup.matched_characters;
+            size_t edge_length = edge_label.length();
+            bool finished = true;
+
+            if (lcp == suffix_length)
+            {
+                results[lookup.index] = 1;
+            }
+            else if (lcp == edge_length)
+            {
+                lookup.matched_characters = lookup.matched_characters + lcp;
+                Node* next_node = find_child(lookup.node, trie.letter_at(elem, lookup.matched_characters));
+                if (next_node == nullptr)
+                {
+                    results[lookup.index] = 0;
+                }
+                else
+                {
+                    __builtin_prefetch(next_node);
+                    lookup.node = next_node;
+                    finished = false;
+                }
+            }
+            else
+            {
+                results[lookup.index] = 0;
+            }
+
+            if (finished && !start_lookup(lookup))
+            {
+                // There are no words left to start, so the group shrinks. The last lookup takes this
+                // position and still has to do its step in this round.
+                group[i] = group[group_size - 1];
+                group_size--;
+                i--;
+            }
+        }
+    }
+}
+
+// This function answers contains for a whole batch of words like batch_contains, but it looks them up in sorted
+// order, so that words with a common prefix share their walk, like in a merge join of the sorted words with the
+// trie.
+//
+// Every lane walks the words of one part of the sorted batch, one after another. The nodes on the path of its
+// last word, whose labels it matched completely, stay on a stack. The next word shares its first letters with
+// the last one, so every node on the stack, that ends within them, is on its path as well, and its walk starts
+// at the deepest of these nodes instead of at the root. The same word again gets the same answer, and a word
+// that shares the letter with the last one, that the trie did not have, is not in the trie either. Like in
+// batch_contains, up to MAX_LANES lanes take turns, each one does one step and prefetches the node it needs
+// next. The answers are stored at the positions of the words in elems.
+template<class Node, class FindChild, class LabelOf>
+void sorted_contains(const Trie& trie, Node* root, std::span<const std::string_view> elems, std::vector<bool>& results,
+                     FindChild find_child, LabelOf label_of) {
+    static const size_t MAX_LANES = 16;
+    static const size_t NO_MISS = SIZE_MAX;
+
+    // A node on the path and the number of letters that are matched at the end of its label.
+    struct Step {
+        Node* node;
+        size_t matched_characters;
+    };
+
+    struct Lane {
+        size_t next;                    // the position in order of the next word
+        size_t end;
+        std::vector<Step> path;
+        bool has_previous = 0;          // if the lane answered a word already, previous
+        std::string_view previous;
+        bool previous_result = 0;
+        size_t previous_miss = NO_MISS; // the position of the first letter of previous, that the trie does not have
+
+        // The running lookup: the word at position current in order, and the node whose label is compared next.
+        size_t current;
+        Node* node = nullptr;
+    };
+
+    results.resize(elems.size());
+    std::vector<uint32_t> order = sorted_positions(elems);
+
+    size_t nbr_lanes = std::min(MAX_LANES, (elems.size() + 1) / 2);
+    Lane lanes[MAX_LANES];
+    for (size_t l = 0; l < nbr_lanes; l++)
+    {
+        lanes[l].next = elems.size() * l / nbr_lanes;
+        lanes[l].end = elems.size() * (l + 1) / nbr_lanes;
+        lanes[l].path.push_back(Step{root, 0});
+    }
+
+    // This function ends the running lookup of the lane with its result.
+    auto finish = [&](Lane& lane, bool result, size_t miss) {
+        results[order[lane.current]] = result;
+        lane.has_previous = 1;
+        lane.previous = elems[order[lane.current]];
+        lane.previous_result = result;
+        lane.previous_miss = miss;
+        lane.node = nullptr;
+    };
+
+    // This function looks for the child of the last node on the path of the lane, that the running lookup
+    // needs next, and prefetches it. It returns false if the lookup ended there.
+    auto descend = [&](Lane& lane) {
+        std::string_view elem = elems[order[lane.current]];
+        size_t matched_characters = lane.path.back().matched_characters;
+        Node* next_node = find_child(lane.path.back().node, trie.letter_at(elem, matched_characters));
+        if (next_node == nullptr)
+        {
+            finish(lane, 0, matched_characters);
+            return false;
+        }
+        __builtin_prefetch(next_node);
+        lane.node = next_node;
+        return true;
+    };
+
+    // This function starts the lookup of the next word of the lane, that is not answered by the word before
+    // it. It returns false if the lane has no word left.
+    auto start_lookup = [&](Lane& lane) {
+        while (lane.next < lane.end)
+        {
+            lane.current = lane.next++;
+            std::string_view elem = elems[order[lane.current]];
+            size_t shared = trie.lcp_function(lane.previous, elem);
+
+            if (lane.has_previous && shared == elem.length() && shared == lane.previous.length())
+            {
+                finish(lane, lane.previous_result, lane.previous_miss);
+                continue;
+            }
+            if (lane.previous_miss != NO_MISS && shared > lane.previous_miss)
+            {
+                // The letters up to the miss are the same as in previous, so the miss stays where it is.
+                finish(lane, 0, lane.previous_miss);
+                continue;
+            }
+
+            while (lane.path.back().matched_characters > shared) lane.path.pop_back();
+            if (descend(lane)) return true;
+        }
+        return false;
+    };
+
+    Lane* running[MAX_LANES];
+    size_t nbr_running = 0;
+    for (size_t l = 0; l < nbr_lanes; l++)
+    {
+        if (start_lookup(lanes[l])) running[nbr_running++] = &lanes[l];
+    }
+
+    while (nbr_running > 0)
+    {
+        for (size_t i = 0; i < nbr_running; i++)
+        {
+            Lane& lane = *running[i];
+            std::string_view elem = elems[order[lane.current]];
+            size_t matched_characters = lane.path.back().matched_characters;
+
+            // This is one step of the loop in contains.
+            std::string_view edge_label = label_of(lane.node);
+            size_t lcp = trie.lcp_function(elem.substr(matched_characters), edge_label);
+            bool running_on;
+
+            if (lcp == elem.length() - matched_characters)
+            {
+                finish(lane, 1, NO_MISS);
+                running_on = start_lookup(lane);
+            }
+            else if (lcp < edge_label.length())
+            {
+                finish(lane, 0, matched_characters + lcp);
+                running_on = start_lookup(lane);
+            }
+            else
+            {
+                lane.path.push_back(Step{lane.node, matched_characters + lcp});
+                running_on = descend(lane) || start_lookup(lane);
+            }
+
+            if (!running_on)
+            {
+                // The lane has no words left, so the last running lane takes its position and still has to do
+                // its step in this round.
+                running[i] = running[nbr_running - 1];
+                nbr_running--;
+                i--;
+            }
+        }
+    }
+}
@@ -0,0 +1,180 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "Tries.hpp"
+#include "Workloads.hpp"
+#include "FixedSize.cpp"
+#include "VariableSizeTrie.cpp"
+#include "HashTableTrie.cpp"
+#include "AdaptiveRadixTrie.cpp"
+#include "ConcurrentTrie.cpp"
+#include "BurstTrie.cpp"
+
+// A benchmark suite, that runs every trie variant on synthetic workloads (see Workloads.hpp). Usage:
+//
+//   ti_bench [-keys=N] [-ops=N] [-seed=N] [-workload=NAME] [-version=N]
+//
+// -workload and -version run only one workload or variant. For every workload and variant one line is printed:
+//
+//   BENCH workload=... variant=... keys=... build_ns_per_key=... bytes_per_key=... ops=... ns_per_op=...
+//         ops_per_s=... successes=...
+//
+// bytes_per_key are the bytes of the built trie, as Trie::stats counts them (the nodes with their unused child
+// slots, and the labels outside of the nodes). The RSS is no measure for that: the process already has freed heap
+// from generating the workloads, and the malloc based variants fill that first. Every variant runs in a process
+// of its own, so that one variant does not see the freed nodes of the one before it either. successes counts the
+// querries that returned true, so it is the same for every variant of a workload, and it changes when a change
+// breaks one.
+
+struct Workload {
+    std::string name;
+    std::vector<std::string> keys;
+    std::vector<workloads::Operation> operations;
+};
+
+static const char* VARIANT_NAMES[] = {"", "fixed_size_array_trie", "variable_size_array_trie", "hash_table_trie",
+                                      "adaptive_radix_trie", "concurrent_trie", "burst_trie"};
+
+static std::unique_ptr<Trie> make_trie(int version_nbr) {
+    switch (version_nbr)
+    {
+        case 1: return std::make_unique<FixedSizeArrayTrie>();
+        case 2: return std::make_unique<VariableSizeArrayTrie>();
+        case 3: return std::make_unique<HashTableTrie>();
+        case 4: return std::make_unique<AdaptiveRadixTrie>();
+        case 5: return std::make_unique<ConcurrentTrie>();
+        default: return std::make_unique<BurstTrie>();
+    }
+}
+
+// This function generates all workloads. The keys that are missed or inserted later are generated together
+// with the keys of the trie, so that they are different from all of them.
+static std::vector<Workload> make_workloads(size_t nbr_keys, size_t nbr_operations, uint64_t seed) {
+    using namespace workloads;
+    std::mt19937_64 rng(seed);
+    std::vector<Workload> result;
+
+    auto split = [&](std::vector<std::string> all, std::vector<std::string>& rest) {
+        rest.assign(all.begin() + nbr_keys, all.end());
+        all.resize(nbr_keys);
+        return all;
+    };
+
+    std::vector<std::string> misses;
+    std::vector<std::string> uniform = split(uniform_keys(nbr_keys + nbr_keys / 2, rng), misses);
+    result.push_back(Workload{"uniform", uniform, lookups(uniform, misses, nbr_operations, 50, rng)});
+    result.push_back(Workload{"zipf", uniform, zipf_lookups(uniform, nbr_operations, 0.99, rng)});
+
+    std::vector<std::string> url_misses;
+    std::vector<std::string> urls = split(url_keys(nbr_keys + nbr_keys / 2, rng), url_misses);
+    result.push_back(Workload{"urls", urls, lookups(urls, url_misses, nbr_operations, 50, rng)});
+
+    std::vector<std::string> numeric_misses;
+    std::vector<std::string> numeric = split(numeric_keys(nbr_keys + nbr_keys / 2, rng), numeric_misses);
+    result.push_back(Workload{"numeric", numeric, lookups(numeric, numeric_misses, nbr_operations, 50, rng)});
+
+    // The mixed workloads insert up to half of their querries as new keys.
+    std::vector<std::string> fresh;
+    std::vector<std::string> mixed = split(uniform_keys(nbr_keys + nbr_operations / 2, rng), fresh);
+    result.push_back(Workload{"mixed_read_heavy", mixed, mixed_operations(mixed, fresh, nbr_operations, 5, 5, rng)});
+    result.push_back(Workload{"mixed_balanced", mixed, mixed_operations(mixed, fresh, nbr_operations, 25, 25, rng)});
+    result.push_back(Workload{"mixed_write_heavy", mixed, mixed_operations(mixed, fresh, nbr_operations, 45, 45, rng)});
+
+    return result;
+}
+
+static void run(const Workload& workload, int version_nbr) {
+    std::unique_ptr<Trie> trie = make_trie(version_nbr);
+
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string& key : workload.keys) trie->insert(key);
+    auto end = std::chrono::steady_clock::now();
+    double build_ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+    // The child slack is a part of the node bytes already, so it is not added again.
+    TrieStats stats = trie->stats();
+    size_t trie_bytes = stats.node_bytes() + stats.label_bytes;
+
+    size_t successes = 0;
+    start = std::chrono::steady_clock::now();
+    for (const workloads::Operation& operation : workload.operations)
+    {
+        if (operation.type == 'c') successes += trie->contains(operation.word);
+        else if (operation.type == 'i') successes += trie->insert(operation.word);
+        else successes += trie->delete_elem(operation.word);
+    }
+    end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    size_t nbr_operations = workload.operations.size();
+
+    std::cout << "BENCH"
+              << " workload=" << workload.name
+              << " variant=" << VARIANT_NAMES[version_nbr]
+              << " keys=" << workload.keys.size()
+              << " build_ns_per_key=" << build_ns / workload.keys.size()
+              << " bytes_per_key=" << (double) trie_bytes / workload.keys.size()
+              << " ops=" << nbr_operations
+              << " ns_per_op=" << ns / nbr_operations
+              << " ops_per_s=" << nbr_operations / (ns / 1e9)
+              << " successes=" << successes << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    size_t nbr_keys = 200000;
+    size_t nbr_operations = 1000000;
+    uint64_t seed = 42;
+    std::string only_workload;
+    int only_version = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if (option.find("-keys=") == 0) nbr_keys = std::stoul(option.substr(6));
+        else if (option.find("-ops=") == 0) nbr_operations = std::stoul(option.substr(5));
+        else if (option.find("-seed=") == 0) seed = std::stoull(option.substr(6));
+        else if (option.find("-workload=") == 0) only_workload = option.substr(10);
+        else if (option.find("-version=") == 0) only_version = std::stoi(option.substr(9));
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [-keys=N] [-ops=N] [-seed=N] [-workload=NAME] [-version=N]" << std::endl;
+            return 1;
+        }
+    }
+    if (nbr_keys == 0) throw std::invalid_argument("ti_bench needs at least one key");
+    if (only_version < 0 || only_version > 6) throw std::invalid_argument("Unsupported version number: " + std::to_string(only_version));
+
+    bool found = only_workload.empty();
+    for (const Workload& workload : make_workloads(nbr_keys, nbr_operations, seed))
+    {
+        if (!only_workload.empty() && workload.name != only_workload) continue;
+        found = true;
+
+        for (int version_nbr = 1; version_nbr <= 6; version_nbr++)
+        {
+            if (only_version != 0 && only_version != version_nbr) continue;
+
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                run(workload, version_nbr);
+                _exit(0);
+            }
+            int status;
+            waitpid(pid, &status, 0);
+        }
+    }
+    if (!found)
+    {
+        std::cerr << "Unknown workload: " << only_workload << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
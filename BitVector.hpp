@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A bit vector with rank and select, for the succinct FrozenTrie.
+//
+// The bits are appended to a BitVectorBuilder one after another and then build() adds two small indexes:
+// the number of ones before every block of 512 bits (for rank) and the block of every 512th zero (for
+// select0). With them a query only has to look at one block, which are 8 words and mostly a single cache
+// line. Both indexes together cost 1/8 of a bit per bit.
+//
+// The BitVector itself only points to these three arrays, so it can be used on arrays that were built in
+// memory as well as on arrays in a memory mapped file.
+class BitVector {
+    public:
+        static const size_t WORD_BITS = 64;
+        static const size_t BLOCK_WORDS = 8;
+        static const size_t BLOCK_BITS = BLOCK_WORDS * WORD_BITS;
+        static const size_t SELECT_SAMPLE = 512;
+
+    private:
+        const uint64_t* words = nullptr;
+        const uint64_t* block_ranks = nullptr;     // ones before block b, one more entry for the end
+        const uint64_t* zero_blocks = nullptr;     // block of the zero number k * SELECT_SAMPLE
+        size_t nbr_bits = 0;
+
+        size_t zeros_before_block(size_t block) const {
+            return block * BLOCK_BITS - block_ranks[block];
+        }
+
+        // This function returns the position of the set bit number rank (counted from 0) in x.
+        static size_t select_in_word(uint64_t x, size_t rank) {
+            for (size_t i = 0; i < rank; i++) x = x & (x - 1);
+            return __builtin_ctzll(x);
+        }
+
+    public:
+        BitVector() = default;
+
+        BitVector(const uint64_t* words, const uint64_t* block_ranks, const uint64_t* zero_blocks, size_t nbr_bits)
+            : words(words), block_ranks(block_ranks), zero_blocks(zero_blocks), nbr_bits(nbr_bits) {}
+
+        size_t size() const { return nbr_bits; }
+
+        bool get(size_t pos) const {
+            return (words[pos / WORD_BITS] >> (pos % WORD_BITS)) & 1;
+        }
+
+        // This function returns the number of ones before pos.
+        size_t rank1(size_t pos) const {
+            size_t block = pos / BLOCK_BITS;
+            size_t rank = block_ranks[block];
+            for (size_t w = block * BLOCK_WORDS; w < pos / WORD_BITS; w++) rank += __builtin_popcountll(words[w]);
+            if (pos % WORD_BITS != 0) rank += __builtin_popcountll(words[pos / WORD_BITS] << (WORD_BITS - pos % WORD_BITS));
+            return rank;
+        }
+
+        // This function returns the position of the zero number k (counted from 0).
+        size_t select0(size_t k) const {
+            size_t block = zero_blocks[k / SELECT_SAMPLE];
+            while (zeros_before_block(block + 1) <= k) block++;
+
+            size_t remaining = k - zeros_before_block(block);
+            size_t w = block * BLOCK_WORDS;
+            while (true)
+            {
+                size_t zeros = __builtin_popcountll(~words[w]);
+                if (remaining < zeros) return w * WORD_BITS + select_in_word(~words[w], remaining);
+                remaining = remaining - zeros;
+                w++;
+            }
+        }
+
+        // This function returns the position of the first zero at or after pos. There has to be one.
+        size_t next_zero(size_t pos) const {
+            size_t w = pos / WORD_BITS;
+            uint64_t zeros = ~words[w] & (~(uint64_t) 0 << (pos % WORD_BITS));
+            while (zeros == 0)
+            {
+                w++;
+                zeros = ~words[w];
+            }
+            return w * WORD_BITS + __builtin_ctzll(zeros);
+        }
+};
+
+// This class collects the bits of a BitVector and builds its indexes.
+class BitVectorBuilder {
+    public:
+        std::vector<uint64_t> words;
+        std::vector<uint64_t> block_ranks;
+        std::vector<uint64_t> zero_blocks;
+        size_t nbr_bits = 0;
+
+        void push_back(bool bit) {
+            if (nbr_bits % BitVector::WORD_BITS == 0) words.push_back(0);
+            if (bit) words.back() |= (uint64_t) 1 << (nbr_bits % BitVector::WORD_BITS);
+            nbr_bits++;
+        }
+
+        // This function has to be called once after the last push_back.
+        void build() {
+            const size_t BLOCK_WORDS = BitVector::BLOCK_WORDS;
+            const size_t BLOCK_BITS = BitVector::BLOCK_BITS;
+
+            // A full last block, and one more block of zeros behind it, make the loops of the queries simpler.
+            words.resize((words.size() + BLOCK_WORDS - 1) / BLOCK_WORDS * BLOCK_WORDS + BLOCK_WORDS, 0);
+            size_t nbr_blocks = words.size() / BLOCK_WORDS;
+
+            block_ranks.assign(nbr_blocks + 1, 0);
+            zero_blocks.clear();
+            size_t zeros = 0;
+            for (size_t block = 0; block < nbr_blocks; block++)
+            {
+                size_t ones = 0;
+                for (size_t w = block * BLOCK_WORDS; w < (block + 1) * BLOCK_WORDS; w++) ones += __builtin_popcountll(words[w]);
+                block_ranks[block + 1] = block_ranks[block] + ones;
+
+                // The zeros behind the last bit are not part of the vector.
+                size_t block_end = (block + 1) * BLOCK_BITS < nbr_bits ? (block + 1) * BLOCK_BITS : nbr_bits;
+                size_t block_zeros = block * BLOCK_BITS < block_end ? block_end - block * BLOCK_BITS - ones : 0;
+                while (zero_blocks.size() * BitVector::SELECT_SAMPLE < zeros + block_zeros) zero_blocks.push_back(block);
+                zeros = zeros + block_zeros;
+            }
+        }
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+#include "Tries.hpp"
+
+// This function builds the nodes of a compressed trie from sorted words, bottom-up and without splitting a
+// single node. It works for every trie, the trie only has to say how a node is made.
+//
+// In sorted order, the path of every word is the path of the word before it up to their longest common
+// prefix, and then a new leave. So we only keep the nodes on the path of the last word on a stack. When the
+// next word comes, every node that lies deeper than the common prefix is finished: all of its children are
+// known, so it is created with create_node(label, children, word_end) and becomes a child of the node above
+// it. If the common prefix ends inside the label of a finished node, a node for the common part is put onto
+// the stack in between, exactly where insert would have split. word_end is false only for these nodes.
+// Because of that, the nodes are the same as if the words were inserted one after another in sorted order.
+//
+// The children of the root are handed to add_to_root at the end. Duplicates are skipped, words that are not
+// sorted throw an exception. The words have to stay valid until the function returns.
+template<class Node, class CreateNode, class AddToRoot>
+void build_sorted(const Trie& trie, std::span<const std::string_view> elems, CreateNode create_node, AddToRoot add_to_root) {
+    // A node that is not finished yet. depth is the number of letters from the root to the end of its
+    // label, elem is one of the words going through it and its children start at first_child in children.
+    struct OpenNode {
+        size_t depth;
+        std::string_view elem;
+        size_t first_child;
+        bool word_end;
+    };
+
+    std::vector<OpenNode> stack;
+    std::vector<Node*> children;
+    stack.push_back(OpenNode{0, std::string_view(), 0, false});
+
+    // This function finishes the node on top of the stack. The node below it has to be its parent already.
+    auto finish_node = [&]() {
+        OpenNode node = stack.back();
+        stack.pop_back();
+
+        size_t parent_depth = stack.back().depth;
+        Node* created = create_node(node.elem.substr(parent_depth, node.depth - parent_depth),
+                                    std::span<Node* const>(children).subspan(node.first_child), node.word_end);
+        children.resize(node.first_child);
+        children.push_back(created);
+    };
+
+    std::string_view previous;
+    for (size_t i = 0; i < elems.size(); i++)
+    {
+        std::string_view elem = elems[i];
+        size_t lcp = trie.lcp_function(previous, elem);
+
+        if (i > 0 && lcp == elem.length() && lcp == previous.length()) continue;
+        if (i > 0 && (lcp == elem.length() || (lcp < previous.length() && (unsigned char) elem[lcp] < (unsigned char) previous[lcp])))
+        {
+            throw std::invalid_argument("The words for build_sorted are not sorted: " + std::string(elem));
+        }
+
+        if (elem.empty())
+        {
+            // The empty word is a leave with an empty label right below the root. It is always the first word,
+            // so the root is the only open node.
+            children.push_back(create_node(elem, std::span<Node* const>(), true));
+            previous = elem;
+            continue;
+        }
+
+        while (stack.back().depth > lcp)
+        {
+            if (stack[stack.size() - 2].depth < lcp)
+            {
+                // The common prefix ends inside the label of the node on top. The node for the common part gets
+                // the same children, since the finished node becomes its first child.
+                OpenNode top = stack.back();
+                stack.back() = OpenNode{lcp, top.elem, top.first_child, false};
+                stack.push_back(top);
+            }
+            finish_node();
+        }
+
+        stack.push_back(OpenNode{elem.length(), elem, children.size(), true});
+        previous = elem;
+    }
+
+    while (stack.size() > 1) finish_node();
+    add_to_root(std::span<Node* const>(children));
+}
@@ -0,0 +1,478 @@
+#include "Tries.hpp"
+#include "BulkLoad.hpp"
+#include "FrozenTrie.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+// A burst trie (like the HAT-trie, but with sorted buckets).
+//
+// The upper part of the trie is an uncompressed trie with one letter per level, the access trie. Below it, all
+// words of a subtree are kept in a bucket: one block of memory with the rest of the words after the path to the
+// bucket, sorted and packed one after another, each behind its length. A lookup walks a few access nodes and then
+// scans a single bucket from the front, which is one run of neighbouring cache lines instead of a chain of small
+// nodes spread over the heap. When a bucket grows beyond BURST_BYTES, it bursts: it is replaced by an access node,
+// whose children are new buckets with the words sorted by their first letter.
+//
+// Like the other tries, contains is true for every prefix of a word (and the empty word only if it was
+// inserted), and delete_elem removes all words that begin with the given word.
+//
+// contains_batch, bulk_load and insert_parallel are not overridden, so they are the plain loops of Trie: one
+// contains or insert after another, with a single thread. Only freeze and stats walk the buckets themselves.
+class BurstTrie final : public Trie {
+    private:
+        static const size_t BURST_BYTES = 1024;
+        static const size_t MIN_BUCKET_BYTES = 64;
+
+        // The words in a bucket, each one as its length (one byte below 128, otherwise a varint) and its letters.
+        struct Bucket {
+            uint32_t used;
+            uint32_t capacity;
+            uint32_t nbr_words;
+            char data[];
+        };
+
+        struct Node;
+
+        // A child is either an access node or a bucket. Both are aligned, so the lowest bit tells them apart.
+        using Child = uintptr_t;
+
+        static bool is_bucket(Child child) { return child & 1; }
+        static Bucket* as_bucket(Child child) { return (Bucket*) (child & ~(uintptr_t) 1); }
+        static Node* as_node(Child child) { return (Node*) child; }
+        static Child bucket_child(Bucket* bucket) { return (uintptr_t) bucket | 1; }
+        static Child node_child(Node* node) { return (uintptr_t) node; }
+
+        // An access node has one child per letter, the letters are sorted, so that a walk over the trie sees the
+        // words in sorted order. word_end is set if a word ends at the node, which happens after a burst or when
+        // the word is inserted after longer ones. A node, that is not the root, always has a word below it.
+        struct Node {
+            std::vector<uint8_t> letters;
+            std::vector<Child> children;
+            bool word_end = false;
+
+            Child* find_child(char letter) {
+                if (letters.empty()) return nullptr;
+                const void* found = std::memchr(letters.data(), (uint8_t) letter, letters.size());
+                if (found == nullptr) return nullptr;
+                return &children[(const uint8_t*) found - letters.data()];
+            }
+
+            void add_child(char letter, Child child) {
+                size_t position = std::lower_bound(letters.begin(), letters.end(), (uint8_t) letter) - letters.begin();
+                letters.insert(letters.begin() + position, (uint8_t) letter);
+                children.insert(children.begin() + position, child);
+            }
+
+            void delete_child(char letter) {
+                size_t position = (const uint8_t*) std::memchr(letters.data(), (uint8_t) letter, letters.size()) - letters.data();
+                letters.erase(letters.begin() + position);
+                children.erase(children.begin() + position);
+            }
+        };
+
+        Node* root;
+
+        // This function reads the length in front of a word of a bucket and returns the position of its letters.
+        static const char* read_length(const char* position, size_t& length) {
+            length = 0;
+            for (size_t shift = 0; ; shift = shift + 7)
+            {
+                uint8_t byte = (uint8_t) *position++;
+                length = length | ((size_t) (byte & 127) << shift);
+                if (byte < 128) return position;
+            }
+        }
+
+        static size_t length_bytes(size_t length) {
+            size_t bytes = 1;
+            while (length >= 128)
+            {
+                length = length >> 7;
+                bytes++;
+            }
+            return bytes;
+        }
+
+        static char* write_length(char* position, size_t length) {
+            while (length >= 128)
+            {
+                *position++ = (char) ((length & 127) | 128);
+                length = length >> 7;
+            }
+            *position++ = (char) length;
+            return position;
+        }
+
+        // This function calls f with every word of the bucket, in sorted order, until f returns false.
+        template<class F>
+        static void for_each_word(const Bucket* bucket, F f) {
+            const char* position = bucket->data;
+            const char* end = bucket->data + bucket->used;
+            while (position < end)
+            {
+                size_t length;
+                const char* word = read_length(position, length);
+                position = word + length;
+                if (!f(std::string_view(word, length), word - bucket->data)) return;
+            }
+        }
+
+        static Bucket* create_bucket(size_t capacity) {
+            if (capacity < MIN_BUCKET_BYTES) capacity = MIN_BUCKET_BYTES;
+            Bucket* bucket = (Bucket*) std::malloc(sizeof(Bucket) + capacity);
+            if (bucket == nullptr) throw std::bad_alloc();
+            bucket->used = 0;
+            bucket->capacity = capacity;
+            bucket->nbr_words = 0;
+            return bucket;
+        }
+
+        // This function appends a word behind the last word of the bucket. The words have to come in sorted order.
+        static Bucket* append_word(Bucket* bucket, std::string_view word) {
+            size_t needed = bucket->used + length_bytes(word.length()) + word.length();
+            if (needed > bucket->capacity)
+            {
+                size_t capacity = std::max<size_t>(needed, 2 * bucket->capacity);
+                bucket = (Bucket*) std::realloc(bucket, sizeof(Bucket) + capacity);
+                if (bucket == nullptr) throw std::bad_alloc();
+                bucket->capacity = capacity;
+            }
+            char* position = write_length(bucket->data + bucket->used, word.length());
+            std::memcpy(position, word.data(), word.length());
+            bucket->used = needed;
+            bucket->nbr_words++;
+            return bucket;
+        }
+
+        // This function checks if a word of the bucket begins with suffix. The words that begin with suffix come
+        // right behind the words that are smaller than it, so only the first word that is not smaller is checked.
+        static bool bucket_contains(const Bucket* bucket, std::string_view suffix) {
+            bool found = false;
+            for_each_word(bucket, [&](std::string_view word, size_t) {
+                if (word < suffix) return true;
+                found = word.starts_with(suffix);
+                return false;
+            });
+            return found;
+        }
+
+        // This function inserts suffix at its sorted position and returns false, if it was in the bucket already.
+        // A word of the bucket, that only begins with suffix, is another word, suffix still gets an entry of its
+        // own.
+        static bool bucket_insert(Bucket*& bucket, std::string_view suffix) {
+            size_t insert_position = bucket->used;
+            bool found = false;
+            for_each_word(bucket, [&](std::string_view word, size_t offset) {
+                if (word < suffix) return true;
+                insert_position = offset - length_bytes(word.length());
+                found = word == suffix;
+                return false;
+            });
+            if (found) return 0;
+
+            size_t entry_bytes = length_bytes(suffix.length()) + suffix.length();
+            size_t old_used = bucket->used;
+            if (old_used + entry_bytes > bucket->capacity)
+            {
+                size_t capacity = std::max<size_t>(old_used + entry_bytes, 2 * bucket->capacity);
+                bucket = (Bucket*) std::realloc(bucket, sizeof(Bucket) + capacity);
+                if (bucket == nullptr) throw std::bad_alloc();
+                bucket->capacity = capacity;
+            }
+            char* position = bucket->data + insert_position;
+            std::memmove(position + entry_bytes, position, old_used - insert_position);
+            position = write_length(position, suffix.length());
+            std::memcpy(position, suffix.data(), suffix.length());
+            bucket->used = old_used + entry_bytes;
+            bucket->nbr_words++;
+            return 1;
+        }
+
+        // This function removes all words of the bucket, that begin with prefix, and returns if there were any.
+        // Since they are sorted, they are one block of bytes.
+        static bool bucket_delete(Bucket* bucket, std::string_view prefix) {
+            size_t begin = bucket->used;
+            size_t end = bucket->used;
+            size_t removed = 0;
+            for_each_word(bucket, [&](std::string_view word, size_t offset) {
+                if (word < prefix) return true;
+
+                size_t entry = offset - length_bytes(word.length());
+                if (!word.starts_with(prefix))
+                {
+                    end = entry;
+                    return false;
+                }
+                if (removed == 0) begin = entry;
+                removed++;
+                return true;
+            });
+            if (removed == 0) return 0;
+
+            std::memmove(bucket->data + begin, bucket->data + end, bucket->used - end);
+            bucket->used = bucket->used - (end - begin);
+            bucket->nbr_words = bucket->nbr_words - removed;
+            return 1;
+        }
+
+        // This function replaces a bucket by an access node. The words are handed down to new buckets by their
+        // first letter, an empty word marks the node itself. Buckets that are still too big burst again.
+        static Node* burst(Bucket* bucket) {
+            Node* node = new Node();
+            Bucket* current = nullptr;
+            char current_letter = 0;
+
+            auto finish_bucket = [&]() {
+                if (current == nullptr) return;
+                node->add_child(current_letter, bucket_child(current));
+            };
+
+            for_each_word(bucket, [&](std::string_view word, size_t) {
+                if (word.empty())
+                {
+                    node->word_end = 1;
+                    return true;
+                }
+                if (current == nullptr || word[0] != current_letter)
+                {
+                    finish_bucket();
+                    current = create_bucket(0);
+                    current_letter = word[0];
+                }
+                current = append_word(current, word.substr(1));
+                return true;
+            });
+            finish_bucket();
+            std::free(bucket);
+
+            for (Child& child : node->children)
+            {
+                Bucket* child_bucket = as_bucket(child);
+                if (child_bucket->used > BURST_BYTES && child_bucket->nbr_words > 1) child = node_child(burst(child_bucket));
+            }
+            return node;
+        }
+
+        static void release(Child child) {
+            if (is_bucket(child))
+            {
+                std::free(as_bucket(child));
+                return;
+            }
+            Node* node = as_node(child);
+            for (Child grandchild : node->children) release(grandchild);
+            delete node;
+        }
+
+        // This function walks the trie in sorted order and calls f with every word.
+        template<class F>
+        void for_each_elem(Child child, std::string& path, F& f) const {
+            if (is_bucket(child))
+            {
+                for_each_word(as_bucket(child), [&](std::string_view word, size_t) {
+                    f(path + std::string(word));
+                    return true;
+                });
+                return;
+            }
+            Node* node = as_node(child);
+            if (node->word_end) f(path);
+            for (size_t i = 0; i < node->letters.size(); i++)
+            {
+                path.push_back((char) node->letters[i]);
+                for_each_elem(node->children[i], path, f);
+                path.pop_back();
+            }
+        }
+
+    public:
+        BurstTrie() {
+            root = new Node();
+        }
+
+        ~BurstTrie() override {
+            release(node_child(root));
+        }
+
+        bool insert(std::string_view elem) override {
+            if (elem.empty())
+            {
+                if (root->word_end) return 0;
+                root->word_end = 1;
+                return 1;
+            }
+
+            Node* current_node = root;
+            size_t depth = 0;
+            while (true)
+            {
+                Child* child = current_node->find_child(elem[depth]);
+                std::string_view suffix = elem.substr(depth + 1);
+
+                if (child == nullptr)
+                {
+                    // There is no child for the next letter, so the rest of the word gets a new bucket.
+                    current_node->add_child(elem[depth], bucket_child(append_word(create_bucket(suffix.length() + 1), suffix)));
+                    return 1;
+                }
+                if (is_bucket(*child))
+                {
+                    Bucket* bucket = as_bucket(*child);
+                    bool inserted = bucket_insert(bucket, suffix);
+                    if (bucket->used > BURST_BYTES && bucket->nbr_words > 1) *child = node_child(burst(bucket));
+                    else *child = bucket_child(bucket);
+                    return inserted;
+                }
+
+                // The word ends at an access node. It was only in the trie before, if the node already was a word
+                // end, and not only a prefix of the words below it.
+                Node* node = as_node(*child);
+                if (suffix.empty())
+                {
+                    if (node->word_end) return 0;
+                    node->word_end = 1;
+                    return 1;
+                }
+                current_node = node;
+                depth++;
+            }
+        }
+
+        bool contains(std::string_view elem) const override {
+            if (elem.empty()) return root->word_end;
+
+            Node* current_node = root;
+            size_t depth = 0;
+            while (true)
+            {
+                Child* child = current_node->find_child(elem[depth]);
+                if (child == nullptr) return 0;
+
+                std::string_view suffix = elem.substr(depth + 1);
+                if (is_bucket(*child)) return bucket_contains(as_bucket(*child), suffix);
+                if (suffix.empty()) return 1;
+
+                current_node = as_node(*child);
+                depth++;
+            }
+        }
+
+        bool delete_elem(std::string_view elem) override {
+            if (elem.empty())
+            {
+                bool was_contained = root->word_end;
+                root->word_end = 0;
+                return was_contained;
+            }
+
+            // The access nodes on the path, so that nodes without words can be removed on the way back up.
+            std::vector<Node*> path;
+            Node* current_node = root;
+            size_t depth = 0;
+            bool deleted = false;
+            while (true)
+            {
+                Child* child = current_node->find_child(elem[depth]);
+                if (child == nullptr) return 0;
+
+                std::string_view suffix = elem.substr(depth + 1);
+                if (is_bucket(*child))
+                {
+                    Bucket* bucket = as_bucket(*child);
+                    if (suffix.empty()) bucket->nbr_words = 0;
+                    else deleted = bucket_delete(bucket, suffix);
+                    if (bucket->nbr_words == 0)
+                    {
+                        deleted = true;
+                        std::free(bucket);
+                        current_node->delete_child(elem[depth]);
+                    }
+                    break;
+                }
+                if (suffix.empty())
+                {
+                    // All words below this access node begin with elem.
+                    release(*child);
+                    current_node->delete_child(elem[depth]);
+                    deleted = true;
+                    break;
+                }
+                path.push_back(current_node);
+                current_node = as_node(*child);
+                depth++;
+            }
+
+            // Access nodes, that have no word left, are removed from their parents.
+            while (current_node != root && current_node->children.empty() && !current_node->word_end)
+            {
+                delete current_node;
+                depth--;
+                current_node = path.back();
+                path.pop_back();
+                current_node->delete_child(elem[depth]);
+            }
+            return deleted;
+        }
+
+        // The words are taken out in sorted order and built into a compressed trie with build_sorted, which is then
+        // frozen like the other tries.
+        std::unique_ptr<FrozenTrie> freeze() const override {
+            struct FreezeNode {
+                std::string_view label;
+                std::vector<FreezeNode*> children;
+            };
+
+            std::vector<std::string> words;
+            std::string path;
+            auto collect = [&](std::string word) { words.push_back(std::move(word)); };
+            for_each_elem(node_child(root), path, collect);
+            std::vector<std::string_view> views(words.begin(), words.end());
+
+            std::deque<FreezeNode> nodes;
+            FreezeNode frozen_root;
+            build_sorted<FreezeNode>(*this, views,
+                [&](std::string_view label, std::span<FreezeNode* const> children, bool) {
+                    nodes.push_back(FreezeNode{label, std::vector<FreezeNode*>(children.begin(), children.end())});
+                    return &nodes.back();
+                },
+                [&](std::span<FreezeNode* const> children) {
+                    frozen_root.children.assign(children.begin(), children.end());
+                });
+
+            return std::make_unique<FrozenTrie>(&frozen_root,
+                [](FreezeNode* node) { return node->label; },
+                [](FreezeNode* node, auto f) { for (FreezeNode* child : node->children) f(child); });
+        }
+
+        // Access nodes and buckets are both counted as nodes. The letters of the words in the buckets are their
+        // labels, and the unused end of a bucket is its slack.
+        TrieStats stats() const override {
+            return collect_stats<Child>(node_child(root),
+                [](Child child, auto f) {
+                    if (is_bucket(child)) return;
+                    for (Child grandchild : as_node(child)->children) f(grandchild);
+                },
+                [](Child child, size_t nbr_children, TrieStats& stats) {
+                    if (is_bucket(child))
+                    {
+                        Bucket* bucket = as_bucket(child);
+                        stats.add_node("bucket", sizeof(Bucket) + bucket->capacity - bucket->used);
+                        stats.label_bytes = stats.label_bytes + bucket->used;
+                        stats.child_slack_bytes = stats.child_slack_bytes + bucket->capacity - bucket->used;
+                        stats.nbr_word_ends = stats.nbr_word_ends + bucket->nbr_words;
+                        return;
+                    }
+                    Node* node = as_node(child);
+                    stats.add_node("access_node", sizeof(Node) + node->letters.capacity() + node->children.capacity() * sizeof(Child));
+                    stats.child_slack_bytes = stats.child_slack_bytes + (node->children.capacity() - nbr_children) * (sizeof(Child) + 1);
+                    stats.nbr_word_ends = stats.nbr_word_ends + node->word_end;
+                });
+        }
+};
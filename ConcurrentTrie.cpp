@@ -0,0 +1,564 @@
+#include "Tries.hpp"
+#include "Epoch.hpp"
+#include "BulkLoad.hpp"
+#include "ShardedBuild.hpp"
+#include "FrozenTrie.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <thread>
+#include <iostream>
+
+// This trie can be used by many threads at the same time. It uses optimistic lock coupling:
+//
+// Every node has a version counter, that also contains a lock bit and an obsolete bit. A reader never
+// takes a lock. It remembers the version of a node, reads what it needs and then checks that the version
+// did not change in the meantime. If it did, a writer was busy with that node and the reader starts over
+// from the root. Writers descend the same way and only lock the (at most two) nodes they change, by
+// upgrading the version they read to a locked one. If that fails, they start over as well.
+//
+// To make the optimistic reads safe, the parts of a node that a reader compares are never changed in
+// place while they might be read: an edge label is replaced as a whole by switching a pointer, and a node
+// that needs more room for children is replaced by a bigger copy. Unlinked nodes and labels are freed
+// through the EpochManager only when no thread can still be reading them.
+//
+// The nodes are taken from malloc instead of an Arena, since the Arena is not thread safe.
+class ConcurrentTrie final : public Trie {
+    private:
+        // Edge labels are immutable, a split creates new ones.
+        struct Label {
+            uint32_t length;
+            char data[];
+
+            std::string_view view() const { return std::string_view(data, length); }
+        };
+
+        // A node is this header, followed by capacity keys (the first letters of the children's labels)
+        // and capacity child pointers.
+        struct Node {
+            static const uint64_t OBSOLETE = 1;
+            static const uint64_t LOCKED = 2;
+
+            std::atomic<uint64_t> version{0};
+            std::atomic<Label*> label;
+            std::atomic<uint16_t> nbr_children{0};
+            uint16_t capacity;
+            bool word_end = false;      // if a word ends at the end of the label (and not only passes through)
+
+            uint8_t* keys() { return (uint8_t*) (this + 1); }
+            std::atomic<Node*>* children() { return (std::atomic<Node*>*) ((char*) (this + 1) + key_bytes(capacity)); }
+
+            static size_t key_bytes(size_t capacity) { return (capacity + 7) / 8 * 8; }
+            static size_t size(size_t capacity) { return sizeof(Node) + key_bytes(capacity) + capacity * sizeof(Node*); }
+
+            // This function waits while the node is locked and returns its version. must_restart is set if
+            // the node was removed from the trie.
+            uint64_t read_lock(bool& must_restart) {
+                uint64_t v = version.load(std::memory_order_acquire);
+                while (v & LOCKED)
+                {
+                    std::this_thread::yield();
+                    v = version.load(std::memory_order_acquire);
+                }
+                if (v & OBSOLETE) must_restart = true;
+                return v;
+            }
+
+            // This function checks that nothing changed in the node since its version v was read.
+            bool validate(uint64_t v) {
+                std::atomic_thread_fence(std::memory_order_acquire);
+                return version.load(std::memory_order_relaxed) == v;
+            }
+
+            // This function turns a read version into a lock. It fails if the node changed in the meantime.
+            bool upgrade(uint64_t v) {
+                return version.compare_exchange_strong(v, v + LOCKED, std::memory_order_acquire);
+            }
+
+            // This function locks the node without waiting. It fails if the node is locked or obsolete.
+            bool try_lock() {
+                uint64_t v = version.load(std::memory_order_relaxed);
+                return !(v & (LOCKED | OBSOLETE)) && upgrade(v);
+            }
+
+            void lock() {
+                while (true)
+                {
+                    uint64_t v = version.load(std::memory_order_relaxed);
+                    if (!(v & LOCKED) && version.compare_exchange_weak(v, v + LOCKED, std::memory_order_acquire)) return;
+                    std::this_thread::yield();
+                }
+            }
+
+            // Unlocking adds LOCKED once more, which clears the lock bit and counts the version up.
+            void unlock() { version.fetch_add(LOCKED, std::memory_order_release); }
+            void unlock_obsolete() { version.fetch_add(LOCKED + OBSOLETE, std::memory_order_release); }
+
+            // This function checks if there is an edge to a child, that begins with a given letter. It may
+            // run while a writer changes the node, so the result is only valid after validate.
+            Node* find_child(char letter) {
+                uint8_t key = (uint8_t) letter;
+                size_t count = nbr_children.load(std::memory_order_acquire);
+                uint8_t* node_keys = keys();
+                for (size_t i = 0; i < count; i++)
+                {
+                    if (__atomic_load_n(&node_keys[i], __ATOMIC_RELAXED) == key)
+                    {
+                        return children()[i].load(std::memory_order_acquire);
+                    }
+                }
+                return nullptr;
+            }
+
+            // This function adds a child, the node has to be locked and must not be full.
+            void add_child(Node* child) {
+                size_t count = nbr_children.load(std::memory_order_relaxed);
+                __atomic_store_n(&keys()[count], (uint8_t) child->label.load(std::memory_order_relaxed)->data[0], __ATOMIC_RELAXED);
+                children()[count].store(child, std::memory_order_release);
+                nbr_children.store(count + 1, std::memory_order_release);
+            }
+
+            // This function replaces the child with the given first letter, the node has to be locked.
+            void replace_child(char letter, Node* child) {
+                size_t count = nbr_children.load(std::memory_order_relaxed);
+                for (size_t i = 0; i < count; i++)
+                {
+                    if (keys()[i] == (uint8_t) letter) children()[i].store(child, std::memory_order_release);
+                }
+            }
+
+            // This functions delets the child, whoms edge starts with the given letter. The last child
+            // takes its place. The node has to be locked.
+            void delete_child(char letter) {
+                size_t count = nbr_children.load(std::memory_order_relaxed);
+                for (size_t i = 0; i < count; i++)
+                {
+                    if (keys()[i] == (uint8_t) letter)
+                    {
+                        __atomic_store_n(&keys()[i], keys()[count - 1], __ATOMIC_RELAXED);
+                        children()[i].store(children()[count - 1].load(std::memory_order_relaxed), std::memory_order_release);
+                        nbr_children.store(count - 1, std::memory_order_release);
+                        return;
+                    }
+                }
+            }
+        };
+
+        // A node starts without room for children and grows through these capacities. The root gets the
+        // largest one right away, since it has no parent that could take a bigger copy.
+        static size_t next_capacity(size_t capacity) {
+            if (capacity == 0) return 4;
+            if (capacity == 4) return 16;
+            if (capacity == 16) return 64;
+            return 256;
+        }
+
+        EpochManager epochs;
+        Node* root;
+
+        // This function creates a label from one or two parts.
+        static Label* create_label(std::string_view text, std::string_view more_text = std::string_view()) {
+            size_t length = text.length() + more_text.length();
+            Label* label = (Label*) std::malloc(sizeof(Label) + length + 1);
+            if (label == nullptr) throw std::bad_alloc();
+            label->length = length;
+            std::memcpy(label->data, text.data(), text.length());
+            if (!more_text.empty()) std::memcpy(label->data + text.length(), more_text.data(), more_text.length());
+            label->data[length] = 0;
+            return label;
+        }
+
+        static Node* create_node(Label* label, size_t capacity, bool word_end) {
+            void* memory = std::malloc(Node::size(capacity));
+            if (memory == nullptr) throw std::bad_alloc();
+            Node* node = new (memory) Node();
+            node->label.store(label, std::memory_order_relaxed);
+            node->capacity = capacity;
+            node->word_end = word_end;
+            for (size_t i = 0; i < capacity; i++) new (&node->children()[i]) std::atomic<Node*>(nullptr);
+            return node;
+        }
+
+        // This function creates a bigger copy of a locked node, with the same label and children.
+        static Node* grow(Node* node) {
+            Node* bigger = create_node(node->label.load(std::memory_order_relaxed), next_capacity(node->capacity), node->word_end);
+            size_t count = node->nbr_children.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < count; i++)
+            {
+                bigger->keys()[i] = node->keys()[i];
+                bigger->children()[i].store(node->children()[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            bigger->nbr_children.store(count, std::memory_order_relaxed);
+            return bigger;
+        }
+
+        static void free_memory(void* ptr) { std::free(ptr); }
+
+        // This function frees a subtree right away. It is only used when no other thread can access the trie.
+        static void free_subtree(Node* node) {
+            size_t count = node->nbr_children.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < count; i++) free_subtree(node->children()[i].load(std::memory_order_relaxed));
+            std::free(node->label.load(std::memory_order_relaxed));
+            std::free(node);
+        }
+
+        // This function marks a subtree, that was just unlinked from the trie, as obsolete and retires its
+        // nodes and labels. Every node is locked before it is marked, so a writer that is still working in the
+        // subtree either finishes first or notices that the node is gone and starts over.
+        void retire_subtree(Node* node) {
+            node->lock();
+            size_t count = node->nbr_children.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < count; i++) retire_subtree(node->children()[i].load(std::memory_order_relaxed));
+            node->unlock_obsolete();
+
+            epochs.retire(node->label.load(std::memory_order_relaxed), free_memory);
+            epochs.retire(node, free_memory);
+        }
+
+        // This function unlinks deleted_node from node, which is locked and has one other child left, and merges
+        // node into that child: the child gets a new label with both labels and takes the place of node in
+        // parent_node. It locks parent_node and the child as well, without waiting. If that fails, nothing was
+        // changed, node is unlocked again and the function returns false. Otherwise node is retired.
+        //
+        // A reader, that is still in node or in the child, notices the new versions and starts over. A reader,
+        // that took node from parent_node before, finds it obsolete.
+        bool merge_with_only_child(Node* parent_node, uint64_t parent_version, Node* node, Node* deleted_node) {
+            if (!parent_node->upgrade(parent_version))
+            {
+                node->unlock();
+                return false;
+            }
+
+            Node* only_child = node->children()[0].load(std::memory_order_relaxed);
+            if (only_child == deleted_node) only_child = node->children()[1].load(std::memory_order_relaxed);
+            if (!only_child->try_lock())
+            {
+                parent_node->unlock();
+                node->unlock();
+                return false;
+            }
+
+            Label* label = node->label.load(std::memory_order_relaxed);
+            Label* child_label = only_child->label.load(std::memory_order_relaxed);
+            only_child->label.store(create_label(label->view(), child_label->view()), std::memory_order_release);
+            parent_node->replace_child(label->data[0], only_child);
+
+            only_child->unlock();
+            node->unlock_obsolete();
+            parent_node->unlock();
+
+            epochs.retire(child_label, free_memory);
+            epochs.retire(label, free_memory);
+            epochs.retire(node, free_memory);
+            return true;
+        }
+
+    public:
+        ConcurrentTrie() {
+            root = create_node(create_label(""), 256, false);
+        }
+
+        ~ConcurrentTrie() override {
+            free_subtree(root);
+        }
+
+        bool insert(std::string_view elem) override {
+            EpochGuard guard(epochs);
+
+            restart:
+            bool must_restart = false;
+            size_t matched_characters = 0;
+            Node* parent_node = nullptr;
+            uint64_t parent_version = 0;
+            Node* current_node = root;
+            uint64_t current_version = current_node->read_lock(must_restart);
+            if (must_restart) goto restart;
+
+            while (true)
+            {
+                char first_letter = letter_at(elem, matched_characters);
+                Node* next_node = current_node->find_child(first_letter);
+                if (!current_node->validate(current_version)) goto restart;
+
+                if (next_node == nullptr)
+                {
+                    // There is no edge with the first letter of our unmatched suffix. Therefore, the word is not
+                    // in the trie and we can add it here. If the node is full, it is replaced by a bigger copy,
+                    // which means that the parent changes as well and has to be locked first.
+                    if (current_node->nbr_children.load(std::memory_order_relaxed) < current_node->capacity)
+                    {
+                        if (!current_node->upgrade(current_version)) goto restart;
+                        current_node->add_child(create_node(create_label(elem.substr(matched_characters)), 0, true));
+                        current_node->unlock();
+                        return 1;
+                    }
+
+                    if (!parent_node->upgrade(parent_version)) goto restart;
+                    if (!current_node->upgrade(current_version))
+                    {
+                        parent_node->unlock();
+                        goto restart;
+                    }
+
+                    Node* bigger_node = grow(current_node);
+                    bigger_node->add_child(create_node(create_label(elem.substr(matched_characters)), 0, true));
+                    parent_node->replace_child(current_node->label.load(std::memory_order_relaxed)->data[0], bigger_node);
+
+                    current_node->unlock_obsolete();
+                    parent_node->unlock();
+                    epochs.retire(current_node, free_memory);
+                    return 1;
+                }
+
+                // We now step into the next node and compare the suffix of our word with the edge of that node.
+                // The child's version has to be read before the parent is validated, otherwise the child could
+                // have been replaced in between.
+                uint64_t next_version = next_node->read_lock(must_restart);
+                if (must_restart || !current_node->validate(current_version)) goto restart;
+
+                Label* label = next_node->label.load(std::memory_order_acquire);
+                size_t lcp = lcp_function(elem.substr(matched_characters), label->view());
+                size_t suffix_length = elem.length() - matched_characters;
+                size_t edge_length = label->length;
+                if (!next_node->validate(next_version)) goto restart;
+
+                if (lcp == suffix_length && lcp == edge_length)
+                {
+                    // This means, the word ends at the end of the label of next_node, so all of its prefixes are
+                    // in the trie already. It was only in the trie before, if next_node already was a word end.
+                    // word_end is only changed and read (by delete_elem) under the lock of the node.
+                    if (!next_node->upgrade(next_version)) goto restart;
+                    bool was_word_end = next_node->word_end;
+                    next_node->word_end = true;
+                    next_node->unlock();
+                    return !was_word_end;
+                }
+                else if (lcp == edge_length)
+                {
+                    // This means, we can not yet make a decicion weather or not the word is in the trie.
+                    matched_characters = matched_characters + lcp;
+                    parent_node = current_node;
+                    parent_version = current_version;
+                    current_node = next_node;
+                    current_version = next_version;
+                }
+                else
+                {
+                    // This means, that lcp is smaller then edge_length, so we now that the word is not in the
+                    // trie and we can insert it here. If the word ends inside of the label, that is all there is
+                    // to it: the end of the word gets a node of its own.
+                    //
+                    // The new intermediate node gets the matched part of the label and takes the place of
+                    // next_node in current_node. next_node keeps its children and gets a new label with the
+                    // unmatched part. Both nodes are locked for that.
+                    if (!current_node->upgrade(current_version)) goto restart;
+                    if (!next_node->upgrade(next_version))
+                    {
+                        current_node->unlock();
+                        goto restart;
+                    }
+
+                    bool word_ends_here = lcp == suffix_length;
+                    Node* intermediate_node = create_node(create_label(label->view().substr(0, lcp)), 4, word_ends_here);
+
+                    next_node->label.store(create_label(label->view().substr(lcp)), std::memory_order_release);
+                    intermediate_node->add_child(next_node);
+                    if (!word_ends_here) intermediate_node->add_child(create_node(create_label(elem.substr(matched_characters + lcp)), 0, true));
+                    current_node->replace_child(first_letter, intermediate_node);
+
+                    next_node->unlock();
+                    current_node->unlock();
+                    epochs.retire(label, free_memory);
+                    return 1;
+                }
+            }
+        }
+
+        bool contains(std::string_view elem) const override {
+            EpochManager& epoch_manager = const_cast<EpochManager&>(epochs);
+            EpochGuard guard(epoch_manager);
+
+            restart:
+            bool must_restart = false;
+            size_t matched_characters = 0;
+            Node* current_node = root;
+            uint64_t current_version = current_node->read_lock(must_restart);
+            if (must_restart) goto restart;
+
+            while (true)
+            {
+                char first_letter = letter_at(elem, matched_characters);
+                Node* next_node = current_node->find_child(first_letter);
+                if (!current_node->validate(current_version)) goto restart;
+
+                if (next_node == nullptr)
+                {
+                    // There is no edge with the first letter of our unmatched suffix. Therefore, the word is not
+                    // in the trie and we can return false.
+                    return 0;
+                }
+
+                // We now step into the next node and compare the suffix of our word with the edge of that node.
+                uint64_t next_version = next_node->read_lock(must_restart);
+                if (must_restart || !current_node->validate(current_version)) goto restart;
+
+                Label* label = next_node->label.load(std::memory_order_acquire);
+                size_t lcp = lcp_function(elem.substr(matched_characters), label->view());
+                size_t suffix_length = elem.length() - matched_characters;
+                size_t edge_length = label->length;
+                if (!next_node->validate(next_version)) goto restart;
+
+                if (lcp == suffix_length)
+                {
+                    // This means, we reached a leave and therefore the element is contained in the trie.
+                    return 1;
+                }
+                else if (lcp == edge_length)
+                {
+                    // This means, we can not yet make a decicion weather or not the word is contained in the trie.
+                    matched_characters = matched_characters + lcp;
+                    current_node = next_node;
+                    current_version = next_version;
+                }
+                else
+                {
+                    // This means, that lcp is smaller then both edge_length and suffix_length, so we now that
+                    // the word is not contained in the trie.
+                    return 0;
+                }
+            }
+        }
+
+        // The trie is built before any other thread can see it, so the nodes are filled without locks. Every
+        // node gets the smallest capacity its children fit into, like after growing through inserts.
+        void bulk_load(std::span<const std::string_view> elems) override {
+            build_sorted<Node>(*this, elems,
+                [](std::string_view label, std::span<Node* const> children, bool word_end) {
+                    size_t capacity = 0;
+                    while (capacity < children.size()) capacity = next_capacity(capacity);
+
+                    Node* node = create_node(create_label(label), capacity, word_end);
+                    for (Node* child : children) node->add_child(child);
+                    return node;
+                },
+                [this](std::span<Node* const> children) {
+                    for (Node* child : children) root->add_child(child);
+                });
+        }
+
+        // The nodes are taken from malloc, so the shards can be thrown away once their children were moved.
+        void insert_parallel(std::span<const std::string_view> elems, size_t nbr_threads) override {
+            build_sharded<ConcurrentTrie>(*this, elems, nbr_threads,
+                []() { return std::make_unique<ConcurrentTrie>(); },
+                [this](ConcurrentTrie& shard, char letter) {
+                    Node* child = shard.root->find_child(letter);
+                    shard.root->delete_child(letter);
+                    root->add_child(child);
+                });
+        }
+
+        // No other thread may change the trie while it is frozen.
+        std::unique_ptr<FrozenTrie> freeze() const override {
+            return std::make_unique<FrozenTrie>(root,
+                [](Node* node) { return node->label.load(std::memory_order_acquire)->view(); },
+                [](Node* node, auto f) {
+                    size_t count = node->nbr_children.load(std::memory_order_acquire);
+                    for (size_t i = 0; i < count; i++) f(node->children()[i].load(std::memory_order_acquire));
+                });
+        }
+
+        // The nodes are named by their capacity, their slack are the keys and child pointers they do not use.
+        // Labels are blocks of malloc of their own. Like freeze, this must not run next to a writer.
+        TrieStats stats() const override {
+            return collect_stats(root,
+                [](Node* node, auto f) {
+                    size_t count = node->nbr_children.load(std::memory_order_acquire);
+                    for (size_t i = 0; i < count; i++) f(node->children()[i].load(std::memory_order_acquire));
+                },
+                [](Node* node, size_t nbr_children, TrieStats& stats) {
+                    Label* label = node->label.load(std::memory_order_acquire);
+                    stats.add_node("node" + std::to_string(node->capacity), Node::size(node->capacity));
+                    stats.child_slack_bytes = stats.child_slack_bytes + (node->capacity - nbr_children) * (sizeof(uint8_t) + sizeof(Node*));
+                    stats.label_bytes = stats.label_bytes + sizeof(Label) + label->length + 1;
+                    stats.nbr_word_ends = stats.nbr_word_ends + node->word_end;
+                });
+        }
+
+        bool delete_elem(std::string_view elem) override {
+            EpochGuard guard(epochs);
+
+            restart:
+            bool must_restart = false;
+            size_t matched_characters = 0;
+            Node* parent_node = nullptr;
+            uint64_t parent_version = 0;
+            Node* current_node = root;
+            uint64_t current_version = current_node->read_lock(must_restart);
+            if (must_restart) goto restart;
+
+            while (true)
+            {
+                char first_letter = letter_at(elem, matched_characters);
+                Node* next_node = current_node->find_child(first_letter);
+                if (!current_node->validate(current_version)) goto restart;
+
+                if (next_node == nullptr)
+                {
+                    // There is no edge with the first letter of our unmatched suffix. Therefore, the word is not
+                    // in the trie and we can return false.
+                    return 0;
+                }
+
+                // We now step into the next node and compare the suffix of our word with the edge of that node.
+                uint64_t next_version = next_node->read_lock(must_restart);
+                if (must_restart || !current_node->validate(current_version)) goto restart;
+
+                Label* label = next_node->label.load(std::memory_order_acquire);
+                size_t lcp = lcp_function(elem.substr(matched_characters), label->view());
+                size_t suffix_length = elem.length() - matched_characters;
+                size_t edge_length = label->length;
+                if (!next_node->validate(next_version)) goto restart;
+
+                if (lcp == suffix_length)
+                {
+                    // This means, we reached a leave and therefore the element was contained in the trie.
+                    // We unlink it (and everything below it) from current_node, which only needs a lock on
+                    // current_node, and retire the unlinked nodes.
+                    if (!current_node->upgrade(current_version)) goto restart;
+
+                    // If current_node is neither the root nor the end of a word and only one child would be left,
+                    // it is merged into that child instead (see merge_with_only_child).
+                    if (parent_node != nullptr && !current_node->word_end && current_node->nbr_children.load(std::memory_order_relaxed) == 2)
+                    {
+                        if (!merge_with_only_child(parent_node, parent_version, current_node, next_node)) goto restart;
+                    }
+                    else
+                    {
+                        current_node->delete_child(first_letter);
+                        current_node->unlock();
+                    }
+
+                    retire_subtree(next_node);
+                    return 1;
+                }
+                else if (lcp == edge_length)
+                {
+                    // This means, we can not yet make a decicion weather or not the word is in the trie.
+                    matched_characters = matched_characters + lcp;
+                    parent_node = current_node;
+                    parent_version = current_version;
+                    current_node = next_node;
+                    current_version = next_version;
+                }
+                else
+                {
+                    // This means, that lcp is smaller then both edge_length and suffix_length, so we now that
+                    // the word is not contained in the trie.
+                    return 0;
+                }
+            }
+        }
+};
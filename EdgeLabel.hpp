@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include "Arena.hpp"
+
+// The edge label of a node, in 16 bytes instead of the 32 of a std::string.
+//
+// A label of up to INLINE_CAPACITY letters is stored in the label itself. A longer label has a label block of
+// its own in the arena of the trie (see Arena::append_label) and only its offset there is kept, together with
+// its first PREFIX_LENGTH letters. So the first letter, which find_child needs, is always in the node itself.
+//
+// Every label owns its block, so a label can be given back (see release) when its node is deleted, and the
+// label blocks of a trie do not grow under inserts and deletes that leave it as it was. The price is, that a
+// split copies the matched part of a long label into a new block, and a merge copies both labels. The rest of
+// a split label is moved to the front of its block, which only gets smaller when its size class does.
+// EdgeLabel has no destructor, since it needs the arena for that: whoever drops a label has to release it.
+class EdgeLabel {
+    public:
+        static const size_t INLINE_CAPACITY = 12;
+
+    private:
+        static const size_t PREFIX_LENGTH = INLINE_CAPACITY - sizeof(uint64_t);
+
+        uint32_t length = 0;
+        char text[INLINE_CAPACITY] = {};    // the label, or its first letters and its offset in the arena
+
+        bool is_inline() const { return length <= INLINE_CAPACITY; }
+
+        uint64_t offset() const {
+            uint64_t offset;
+            std::memcpy(&offset, text + PREFIX_LENGTH, sizeof(uint64_t));
+            return offset;
+        }
+
+        // This function makes this a label for the given letters of the arena.
+        void point_to(uint64_t offset, size_t label_length, const Arena& arena) {
+            length = label_length;
+            std::memcpy(text, arena.label_at(offset), PREFIX_LENGTH);
+            std::memcpy(text + PREFIX_LENGTH, &offset, sizeof(uint64_t));
+        }
+
+        // The label may be a view into text itself, so it is copied over a buffer.
+        void store_inline(std::string_view label) {
+            char buffer[INLINE_CAPACITY] = {};
+            std::memcpy(buffer, label.data(), label.length());
+            std::memcpy(text, buffer, INLINE_CAPACITY);
+            length = label.length();
+        }
+
+    public:
+        EdgeLabel() = default;
+
+        EdgeLabel(std::string_view label, Arena& arena) {
+            if (label.length() <= INLINE_CAPACITY) store_inline(label);
+            else point_to(arena.append_label(label), label.length(), arena);
+        }
+
+        std::string_view view(const Arena& arena) const {
+            if (is_inline()) return std::string_view(text, length);
+            return std::string_view(arena.label_at(offset()), length);
+        }
+
+        size_t size() const { return length; }
+
+        // The first letter of the label, or 0 for the empty label (like letter_at).
+        char first() const { return text[0]; }
+
+        // This function returns the first n letters of the label as a label of its own.
+        EdgeLabel prefix(size_t n, Arena& arena) const {
+            return EdgeLabel(view(arena).substr(0, n), arena);
+        }
+
+        // This function puts the given letters in front of the label, for merging a node into its only child.
+        void prepend(std::string_view letters, Arena& arena) {
+            size_t joined_length = letters.length() + length;
+            if (joined_length <= INLINE_CAPACITY)
+            {
+                char buffer[INLINE_CAPACITY];
+                std::memcpy(buffer, letters.data(), letters.length());
+                std::memcpy(buffer + letters.length(), text, length);
+                store_inline(std::string_view(buffer, joined_length));
+                return;
+            }
+
+            uint64_t joined_offset = arena.append_label(letters, view(arena));
+            release(arena);
+            point_to(joined_offset, joined_length, arena);
+        }
+
+        // This function removes the first n letters of the label.
+        void remove_prefix(size_t n, Arena& arena) {
+            if (n == 0) return;
+            if (is_inline())
+            {
+                store_inline(view(arena).substr(n));
+            }
+            else if (length - n <= INLINE_CAPACITY)
+            {
+                uint64_t old_offset = offset();
+                size_t old_length = length;
+                store_inline(view(arena).substr(n));
+                arena.deallocate_label(old_offset, old_length);
+            }
+            else
+            {
+                point_to(arena.remove_label_prefix(offset(), length, n), length - n, arena);
+            }
+        }
+
+        // This function gives the block of a long label back to the arena. The label must not be used anymore
+        // afterwards.
+        void release(Arena& arena) {
+            if (!is_inline()) arena.deallocate_label(offset(), length);
+            length = 0;
+        }
+};
+
+static_assert(sizeof(EdgeLabel) == 16, "An EdgeLabel should stay as small as two pointers");
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// All edges of a trie in one hash table, keyed by the arena index of the parent and the first letter of the
+// child's label, with the arena index of the child as value.
+//
+// The table uses open addressing with linear probing and Robin Hood hashing: an entry that is further away
+// from its home slot takes the place of one that is closer to its own. So all entries with the same home slot
+// lie next to each other, and a lookup can stop as soon as it meets an entry that is closer to home than it
+// would be itself. A lookup is one hash and (nearly always) a single cache line, and an edge takes 12 bytes
+// plus the empty slots, instead of a bucket list and a map per node.
+//
+// The table does not know which letters a node has, so the caller keeps a bitmap of them for every node (see
+// letter_bit): bit i stands for the letters whose lowest 6 bits are i. To walk the children of a node,
+// for_each_child only probes the letters of the set bits, that appear in the table at all. With the letters of
+// one alphabet, that are rarely more than the children of the node. The bit does not depend on the order in
+// which the letters were seen, so the bitmaps stay right when the edges of another table are moved over.
+class EdgeTable {
+    private:
+        struct Slot {
+            uint32_t parent;        // 0 for an empty slot, 0 is never the index of a node
+            uint32_t child;
+            uint8_t letter;
+            uint8_t distance;       // how far the slot is from the home slot of its entry
+        };
+
+        static const size_t MIN_CAPACITY = 16;
+        static const size_t MAX_DISTANCE = 255;
+
+        std::vector<Slot> slots;
+        size_t mask = 0;
+        size_t nbr_edges = 0;
+        size_t shift = 64;
+
+        // A flag for every letter, that an edge has or had.
+        bool used_letters[256] = {};
+
+        size_t home_of(uint32_t parent, uint8_t letter) const {
+            uint64_t key = ((uint64_t) parent << 8) | letter;
+            return (size_t) ((key * 0x9E3779B97F4A7C15ull) >> shift);
+        }
+
+        // This function returns the slot of the edge, or the number of slots if there is none.
+        size_t position_of(uint32_t parent, uint8_t letter) const {
+            if (slots.empty()) return 0;
+            size_t position = home_of(parent, letter);
+            for (size_t distance = 0; ; distance++)
+            {
+                const Slot& slot = slots[position];
+                if (slot.parent == 0 || slot.distance < distance) return slots.size();
+                if (slot.parent == parent && slot.letter == letter) return position;
+                position = (position + 1) & mask;
+            }
+        }
+
+        void resize(size_t capacity) {
+            std::vector<Slot> old_slots(capacity, Slot{0, 0, 0, 0});
+            old_slots.swap(slots);
+            mask = capacity - 1;
+            shift = 64 - __builtin_ctzll(capacity);
+            nbr_edges = 0;
+            for (const Slot& slot : old_slots)
+            {
+                if (slot.parent != 0) place(slot);
+            }
+        }
+
+        // This function puts an entry into the table, that is not in there yet.
+        void place(Slot entry) {
+            entry.distance = 0;
+            size_t position = home_of(entry.parent, entry.letter);
+            while (true)
+            {
+                Slot& slot = slots[position];
+                if (slot.parent == 0)
+                {
+                    slot = entry;
+                    nbr_edges++;
+                    return;
+                }
+                if (slot.distance < entry.distance) std::swap(slot, entry);
+
+                position = (position + 1) & mask;
+                entry.distance++;
+                if (entry.distance == MAX_DISTANCE)
+                {
+                    // The probe sequence got too long for the distance to be stored. This does not happen with
+                    // a good hash, but a bigger table fixes it anyway.
+                    resize(slots.size() * 2);
+                    place(entry);
+                    return;
+                }
+            }
+        }
+
+    public:
+        // This function returns the bit of the letter in the bitmap of the children of a node.
+        static uint64_t letter_bit(char letter) { return (uint64_t) 1 << ((uint8_t) letter & 63); }
+
+        // This function returns the child of parent, whose label begins with letter, or 0 if there is none.
+        uint32_t find(uint32_t parent, char letter) const {
+            size_t position = position_of(parent, (uint8_t) letter);
+            return position == slots.size() ? 0 : slots[position].child;
+        }
+
+        // This function adds an edge, parent must not have a child with that letter yet. The table is at most
+        // 7/8 full, and doubles its size before that.
+        void insert(uint32_t parent, char letter, uint32_t child) {
+            if ((nbr_edges + 1) * 8 > slots.size() * 7) resize(slots.empty() ? MIN_CAPACITY : slots.size() * 2);
+            used_letters[(uint8_t) letter] = 1;
+            place(Slot{parent, child, (uint8_t) letter, 0});
+        }
+
+        // This function removes an edge. The entries behind it, that are not in their home slot, are moved one
+        // slot back, so that no lookup stops too early. The table halves its size when it is only 1/8 full.
+        void erase(uint32_t parent, char letter) {
+            size_t position = position_of(parent, (uint8_t) letter);
+            if (position == slots.size()) return;
+
+            size_t next = (position + 1) & mask;
+            while (slots[next].parent != 0 && slots[next].distance > 0)
+            {
+                slots[position] = slots[next];
+                slots[position].distance--;
+                position = next;
+                next = (next + 1) & mask;
+            }
+            slots[position] = Slot{0, 0, 0, 0};
+            nbr_edges--;
+
+            if (slots.size() > MIN_CAPACITY && nbr_edges * 8 < slots.size()) resize(slots.size() / 2);
+        }
+
+        // This function checks if parent has a child with another letter, that has the same bit as letter. If not,
+        // the bit can be cleared after the edge with letter was erased.
+        bool shares_letter_bit(uint32_t parent, char letter) const {
+            for (size_t other = (uint8_t) letter & 63; other < 256; other = other + 64)
+            {
+                if (other != (uint8_t) letter && used_letters[other] && find(parent, (char) other) != 0) return 1;
+            }
+            return 0;
+        }
+
+        // This function calls f with the index of every child of parent, whose letters are in the bitmap.
+        template<class F>
+        void for_each_child(uint32_t parent, uint64_t letter_bits, F f) const {
+            while (letter_bits != 0)
+            {
+                for (size_t letter = __builtin_ctzll(letter_bits); letter < 256; letter = letter + 64)
+                {
+                    if (!used_letters[letter]) continue;
+                    uint32_t child = find(parent, (char) letter);
+                    if (child != 0) f(child);
+                }
+                letter_bits = letter_bits & (letter_bits - 1);
+            }
+        }
+
+        // This function calls f(parent, letter, child) for every edge of the table.
+        template<class F>
+        void for_each_edge(F f) const {
+            for (const Slot& slot : slots)
+            {
+                if (slot.parent != 0) f(slot.parent, (char) slot.letter, slot.child);
+            }
+        }
+
+        // This function removes all edges and gives the memory of the table back.
+        void clear() {
+            std::vector<Slot>().swap(slots);
+            mask = 0;
+            shift = 64;
+            nbr_edges = 0;
+        }
+
+        size_t size() const { return nbr_edges; }
+
+        size_t capacity() const { return slots.size(); }
+
+        size_t memory_bytes() const { return slots.capacity() * sizeof(Slot); }
+
+        size_t slot_bytes() const { return sizeof(Slot); }
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// Every thread that uses an EpochManager gets a small number while it lives. The numbers are handed
+// out again after a thread ended, so there are never more than MAX_THREADS of them.
+class ThreadSlot {
+    public:
+        static const size_t MAX_THREADS = 256;
+
+    private:
+        static inline std::atomic<bool> taken[MAX_THREADS] = {};
+        size_t index;
+
+        ThreadSlot() {
+            for (index = 0; index < MAX_THREADS; index++)
+            {
+                bool expected = false;
+                if (taken[index].compare_exchange_strong(expected, true)) return;
+            }
+            throw std::runtime_error("More than 256 threads use the concurrent trie at the same time");
+        }
+
+        ~ThreadSlot() { taken[index].store(false); }
+
+    public:
+        // The number of the calling thread.
+        static size_t get() {
+            static thread_local ThreadSlot slot;
+            return slot.index;
+        }
+};
+
+// Epoch based memory reclamation.
+//
+// A node that was unlinked from the trie can still be read by other threads, that found it just before
+// it was unlinked. So it can not be freed right away. Instead, every operation runs inside an epoch
+// (see EpochGuard), and unlinked memory is retired with the global epoch at that time. It is only freed
+// once every thread, that is inside an operation, has entered it in a later epoch, because those threads
+// can not have seen the memory anymore.
+class EpochManager {
+    private:
+        static const uint64_t INACTIVE = UINT64_MAX;
+        static const size_t ADVANCE_INTERVAL = 64;
+
+        struct Retired {
+            void* ptr;
+            void (*deleter)(void*);
+            uint64_t epoch;
+        };
+
+        // Each slot is only written by its own thread, but read by all threads that reclaim memory.
+        struct alignas(64) ThreadState {
+            std::atomic<uint64_t> epoch{INACTIVE};
+            size_t depth = 0;
+            std::vector<Retired> retired;
+        };
+
+        std::atomic<uint64_t> global_epoch{1};
+        ThreadState threads[ThreadSlot::MAX_THREADS];
+
+        uint64_t min_active_epoch() const {
+            uint64_t min_epoch = INACTIVE;
+            for (const ThreadState& state : threads)
+            {
+                uint64_t epoch = state.epoch.load(std::memory_order_acquire);
+                if (epoch < min_epoch) min_epoch = epoch;
+            }
+            return min_epoch;
+        }
+
+        // This function frees everything the calling thread retired before the oldest epoch, that a
+        // thread is still running in.
+        void reclaim(ThreadState& state) {
+            // Pairs with the fence in enter: Either we see the epoch of a thread that just started, or that
+            // thread sees the trie without the retired memory.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            uint64_t min_epoch = min_active_epoch();
+            size_t kept = 0;
+            for (Retired& retired : state.retired)
+            {
+                if (retired.epoch < min_epoch) retired.deleter(retired.ptr);
+                else state.retired[kept++] = retired;
+            }
+            state.retired.resize(kept);
+        }
+
+    public:
+        EpochManager() = default;
+        EpochManager(const EpochManager&) = delete;
+        EpochManager& operator=(const EpochManager&) = delete;
+
+        // When the manager is destroyed no operation can run anymore, so everything is freed.
+        ~EpochManager() {
+            for (ThreadState& state : threads)
+            {
+                for (Retired& retired : state.retired) retired.deleter(retired.ptr);
+            }
+        }
+
+        void enter() {
+            ThreadState& state = threads[ThreadSlot::get()];
+            if (state.depth++ == 0)
+            {
+                state.epoch.store(global_epoch.load(std::memory_order_acquire), std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+        }
+
+        void leave() {
+            ThreadState& state = threads[ThreadSlot::get()];
+            if (--state.depth == 0) state.epoch.store(INACTIVE, std::memory_order_release);
+        }
+
+        // This function hands memory, that is not reachable from the trie anymore, to the manager. The
+        // deleter is called as soon as no thread can hold a pointer to it anymore.
+        void retire(void* ptr, void (*deleter)(void*)) {
+            ThreadState& state = threads[ThreadSlot::get()];
+            state.retired.push_back(Retired{ptr, deleter, global_epoch.load(std::memory_order_acquire)});
+
+            if (state.retired.size() % ADVANCE_INTERVAL == 0)
+            {
+                global_epoch.fetch_add(1, std::memory_order_acq_rel);
+                reclaim(state);
+            }
+        }
+};
+
+// Marks the lifetime of one trie operation. Pointers read from the trie stay valid until the guard ends.
+class EpochGuard {
+    private:
+        EpochManager& manager;
+
+    public:
+        explicit EpochGuard(EpochManager& manager) : manager(manager) { manager.enter(); }
+        ~EpochGuard() { manager.leave(); }
+
+        EpochGuard(const EpochGuard&) = delete;
+        EpochGuard& operator=(const EpochGuard&) = delete;
+};
@@ -1,244 +1,199 @@
-#include "Tries.hpp"
-#include <string>
-#include <memory>
-#include <iostream>
+#include "RadixTrie.hpp"
+#include "Alphabet.hpp"
+#include <algorithm>
+#include <cstring>
+
+// The node policy of FixedSizeArrayTrie (see RadixTrie.hpp).
+//
+// Every letter has a dense code from the alphabet of the trie (see Alphabet.hpp), that is learned from the words
+// before a build and grows when an insert brings a new letter. Any byte can be a letter.
+//
+// Like in a HAMT, a node only stores the children it has: bit i of the bitmap is set if there is a child for the
+// letter with code i, and the children array holds their arena indices in the order of the bits. So the child of
+// bit i is at the number of set bits below i. The first 64 bits of the bitmap are in the node itself, so for the
+// 64 most frequent letters a missing child is found without leaving the node. The words for higher codes are only
+// there if the node needs them: they are in front of the children array, in the same block of the arena.
+class FixedSizeNodes {
+    private:
+        static const size_t BITS = 64;
 
-static const size_t ALPH_SIZE = 64; // a-z : 26, A-Z:26, 0-9: 10, $:1, 0:1 -> 26+26+10+1+1=64
+        Alphabet alphabet;
 
-class FixedSizeArrayTrie : public Trie {
-    private:
+    public:
         struct Node {
-            private:
-                // This char to nbr function translates a char to its position in the children array.
-                // It can deal with both the 0 byte and the $ letter and as long as they do not appear mixed
-                // in an input file, this should not lead to unexpected behaviour.
-                int char_to_nbr(char c) const {
-                    if (c >= 'a' && c <= 'z') return c - 'a';
-                    if (c >= 'A' && c <= 'Z') return c - 'A' + 26;
-                    if (c >= '0' && c <= '9') return c - '0' + 52;
-                    if (c == '$') return 62;
-                    if (c == 0 ) return 63;
-                    throw std::invalid_argument("Unsupported character");
-                }
+            EdgeLabel label;
+            bool word_end;                  // if a word ends at the end of the label (and not only passes through)
+            uint8_t nbr_extra_words = 0;    // the number of 64 bit words of the bitmap in the block
+            uint32_t block = 0;             // the arena index of the extra bitmap words and the children array
+            uint64_t bitmap = 0;            // the bits of the codes below 64
 
-            public: 
-                std::string comp_edge_label;
-                Node** children = (Node**) malloc(ALPH_SIZE * sizeof(Node*));
-
-                Node(std::string edge_label) {
-                    for (size_t i = 0; i < ALPH_SIZE; i++)
-                    {
-                        children[i] = nullptr;
-                    }
-                    
-                    comp_edge_label = edge_label;
-                }
+            Node(EdgeLabel edge_label, bool word_end, Arena&) : label(edge_label), word_end(word_end) {}
 
-                ~Node() { free(children); }
+            Node(std::string_view edge_label, bool word_end, Arena& arena) : Node(EdgeLabel(edge_label, arena), word_end, arena) {}
+        };
 
-                // This function adds a child to the node and stores a pointer to it.
-                void add_child(Node* child_ptr) {
-                    int8_t char_nbr = char_to_nbr(child_ptr->comp_edge_label[0]);
-                    if (children[char_nbr] == nullptr)
-                    {
-                        children[char_nbr] = child_ptr;
-                    }
-                    
-                }
+    private:
+        static size_t block_size(size_t nbr_extra_words, size_t nbr_children) {
+            return nbr_extra_words * sizeof(uint64_t) + nbr_children * sizeof(uint32_t);
+        }
 
-                // This function checks if there is an edge to a child, that begins with a given letter.
-                Node* find_child(char letter) {
-                    return children[char_to_nbr(letter)];
-                }
+        static uint64_t* extra_words(Node* node, const Arena& arena) { return arena.at_index<uint64_t>(node->block); }
 
-                // This functions delets the child, whoms edge starts with the given letter.
-                void delete_child(char letter) {
-                    children[char_to_nbr(letter)] = nullptr;
-                }
-        };
+        static uint32_t* children_of(Node* node, const Arena& arena) {
+            return (uint32_t*) (extra_words(node, arena) + node->nbr_extra_words);
+        }
+
+        // This function returns the word of the bitmap with the bit of code, or nullptr if the node has none.
+        static uint64_t* word_of(Node* node, size_t code, const Arena& arena) {
+            if (code < BITS) return &node->bitmap;
+            if (code / BITS > node->nbr_extra_words) return nullptr;
+            return extra_words(node, arena) + code / BITS - 1;
+        }
+
+        static bool has(Node* node, size_t code, const Arena& arena) {
+            uint64_t* word = word_of(node, code, arena);
+            return word != nullptr && ((*word >> (code % BITS)) & 1);
+        }
 
-        Node *root = new Node("");
+        // This function returns the number of set bits below the bit of code.
+        static size_t position_of(Node* node, size_t code, const Arena& arena) {
+            uint64_t below = (1ull << (code % BITS)) - 1;
+            if (code < BITS) return __builtin_popcountll(node->bitmap & below);
+
+            uint64_t* words = extra_words(node, arena);
+            size_t position = __builtin_popcountll(node->bitmap) + __builtin_popcountll(words[code / BITS - 1] & below);
+            for (size_t i = 0; i + 1 < code / BITS; i++) position = position + __builtin_popcountll(words[i]);
+            return position;
+        }
 
     public:
+        size_t nbr_children(Node* node, const Arena& arena) const {
+            size_t count = __builtin_popcountll(node->bitmap);
+            uint64_t* words = extra_words(node, arena);
+            for (size_t i = 0; i < node->nbr_extra_words; i++) count = count + __builtin_popcountll(words[i]);
+            return count;
+        }
 
-        bool insert(std::string &elem) override {
-            size_t matched_characters = 0;
-            Node* current_node = root;
-            Node* parent_node;
-            Node* new_leave_node;
-            Node* next_node;
-            char first_letter;
+        // This function checks if there is an edge to a child, that begins with a given letter. A letter without
+        // a code has NO_CODE, which is behind every bitmap.
+        Node* find_child(Node* node, char letter, const Arena& arena) const {
+            size_t code = alphabet.code_of(letter);
+            if (!has(node, code, arena)) return nullptr;
+            return arena.at_index<Node>(children_of(node, arena)[position_of(node, code, arena)]);
+        }
 
-            while (true)        
+        // This function calls f for every child of the node.
+        template<class F>
+        void for_each_child(Node* node, const Arena& arena, F f) const {
+            size_t count = nbr_children(node, arena);
+            uint32_t* children = children_of(node, arena);
+            for (size_t i = 0; i < count; i++)
             {
-                first_letter = elem[matched_characters];
-                next_node = current_node->find_child(first_letter);
-
-                if (next_node == nullptr)
-                {   
-                    // There is no edge with the first letter of our unmatched suffix. Therefore, the word is not
-                    // in the trie and we can add it here.
-                    current_node->add_child(new Node(elem.substr(matched_characters)));
-                    return 1;
-                }
-                else
-                {
-                    // We now step into the next node and compare the suffix of our word with the edge of that node.
-                    parent_node = current_node;
-                    current_node = next_node;
-
-                    size_t lcp = lcp_function(elem.substr(matched_characters), current_node->comp_edge_label);
-                    size_t suffix_length = elem.length() - matched_characters;
-                    size_t edge_length = current_node->comp_edge_label.length();
-
-                    if (lcp == suffix_length)
-                    {   
-                        // This means, we reached a leave and therefore the element was alredy in the trie.
-                        return 0;
-                    } 
-                    else if (lcp == edge_length)        
-                    {
-                        // This means, we can not yet make a decicion weather or not the word is in the trie.
-                        matched_characters = matched_characters + lcp;
-                    }
-                    else {
-                        // This means, that lcp is smaller then both edge_length and suffix_length, so we now that 
-                        // the word is not in the trie and we can insert it here.
-                        //
-                        // For that, we now have to split the current_node at lcp and make two child nodes.
-                        // One of the two new nodes will be the a leave (no children) and on its edge we write the 
-                        // unmatched suffix of our word. The other will have the unmatched suffix of the edge label 
-                        // and its children are going to be the children of the current node.
-
-                        // Create new leave and name it accordingly.
-                        new_leave_node = new Node(elem.substr(matched_characters + lcp));
-
-                        // Create new intermediate node and name it accordingly.
-                        current_node = new Node(current_node->comp_edge_label.substr(0,lcp));
-
-                        // Rename the label of the next_node accordingly.
-                        next_node->comp_edge_label = next_node->comp_edge_label.substr(lcp);
-
-                        // Make this new intermediate node the child of the parent_node.
-                        parent_node->delete_child(first_letter);
-                        parent_node->add_child(current_node);
-
-                        // Set the children of the new intermediate node.
-                        current_node->add_child(next_node);
-                        current_node->add_child(new_leave_node);
-
-                        return 1;
-                    }
-                    
-                }
-                
+                f(arena.at_index<Node>(children[i]));
             }
-
-            return 0;
         }
 
-        bool contains(std::string& elem) const override {
-            size_t matched_characters = 0;
-            Node* current_node = root;
-            Node* next_node;
-            char first_letter;
-
-            while (true)        
+        // This function adds a child to the node and stores its index at the position of its bit. The arena only
+        // moves the block when it outgrows its size class, or when the bitmap needs another word for the code.
+        void add_child(Node* node, Node* child_ptr, Arena& arena) {
+            size_t code = alphabet.add(child_ptr->label.first());
+            if (has(node, code, arena)) return;
+
+            size_t count = nbr_children(node, arena);
+            size_t nbr_extra_words = std::max<size_t>(node->nbr_extra_words, code / BITS);
+            void* old_block = extra_words(node, arena);
+            void* block;
+            if (nbr_extra_words == node->nbr_extra_words)
             {
-                first_letter = elem[matched_characters];
-                next_node = current_node->find_child(first_letter);
-
-                if (next_node == nullptr)
-                {   
-                    // There is no edge with the first letter of our unmatched suffix. Therefore, the word is not
-                    // in the trie and we can return false. 
-                    return 0;
-                }
-                else
+                block = arena.reallocate(old_block, block_size(nbr_extra_words, count), block_size(nbr_extra_words, count + 1));
+            }
+            else
+            {
+                // The bitmap gets more words, so the children array moves behind them.
+                block = arena.allocate(block_size(nbr_extra_words, count + 1));
+                std::memset(block, 0, nbr_extra_words * sizeof(uint64_t));
+                if (old_block != nullptr)
                 {
-                    // We now step into the next node and compare the suffix of our word with the edge of that node.
-                    current_node = next_node;
-
-                    size_t lcp = lcp_function(elem.substr(matched_characters), current_node->comp_edge_label);
-                    size_t suffix_length = elem.length() - matched_characters;
-                    size_t edge_length = current_node->comp_edge_label.length();
-
-                    if (lcp == suffix_length)
-                    {   
-                        // This means, we reached a leave and therefore the element is contained in the trie.
-                        return 1;
-                    } 
-                    else if (lcp == edge_length)        
-                    {
-                        // This means, we can not yet make a decicion weather or not the word is contained in the trie.
-                        matched_characters = matched_characters + lcp;
-                    }
-                    else {
-                        // This means, that lcp is smaller then both edge_length and suffix_length, so we now that 
-                        // the word is not contained in the trie.
-                        return 0;
-                    }
-                    
+                    std::memcpy(block, old_block, node->nbr_extra_words * sizeof(uint64_t));
+                    std::memcpy((uint64_t*) block + nbr_extra_words, children_of(node, arena), count * sizeof(uint32_t));
+                    arena.deallocate(old_block, block_size(node->nbr_extra_words, count));
                 }
-                
+                node->nbr_extra_words = (uint8_t) nbr_extra_words;
             }
-
-            return 0;
+            node->block = arena.index_of(block);
+
+            uint64_t* word = word_of(node, code, arena);
+            *word = *word | (1ull << (code % BITS));
+            uint32_t* children = children_of(node, arena);
+            size_t position = position_of(node, code, arena);
+            std::memmove(children + position + 1, children + position, (count - position) * sizeof(uint32_t));
+            children[position] = arena.index_of(child_ptr);
         }
 
-        bool delete_elem(std::string& elem) override{
-            size_t matched_characters = 0;
-            Node* current_node = root;
-            Node* parent_node;
-            Node* next_node;
-            char first_letter;
+        // This functions delets the child, whoms edge starts with the given letter. A node without children gives
+        // its block back.
+        void delete_child(Node* node, char letter, Arena& arena) {
+            size_t code = alphabet.code_of(letter);
+            if (!has(node, code, arena)) return;
+
+            size_t count = nbr_children(node, arena);
+            void* block = extra_words(node, arena);
+            uint32_t* children = children_of(node, arena);
+            size_t position = position_of(node, code, arena);
+            std::memmove(children + position, children + position + 1, (count - position - 1) * sizeof(uint32_t));
+            uint64_t* word = word_of(node, code, arena);
+            *word = *word & ~(1ull << (code % BITS));
+
+            if (count == 1)
+            {
+                arena.deallocate(block, block_size(node->nbr_extra_words, count));
+                node->block = 0;
+                node->nbr_extra_words = 0;
+                return;
+            }
+            block = arena.reallocate(block, block_size(node->nbr_extra_words, count), block_size(node->nbr_extra_words, count - 1));
+            node->block = arena.index_of(block);
+        }
 
-            while (true)        
+        // This function gives the node, its block, its label and all of its descendants back to the arena.
+        void release(Node* node, Arena& arena) {
+            size_t count = nbr_children(node, arena);
+            uint32_t* children = children_of(node, arena);
+            for (size_t i = 0; i < count; i++)
             {
-                first_letter = elem[matched_characters];
-                next_node = current_node->find_child(first_letter);
-
-                if (next_node == nullptr)
-                {   
-                    // There is no edge with the first letter of our unmatched suffix. Therefore, the word is not
-                    // in the trie and we can return false.   
-                    return 0;
-                }
-                else
-                {
-                    // We now step into the next node and compare the suffix of our word with the edge of that node.
-                    parent_node = current_node;
-                    current_node = next_node;
-
-                    size_t lcp = lcp_function(elem.substr(matched_characters), current_node->comp_edge_label);
-                    size_t suffix_length = elem.length() - matched_characters;
-                    size_t edge_length = current_node->comp_edge_label.length();
-
-                    if (lcp == suffix_length)
-                    {   
-                        // This means, we reached a leave and therefore the element was contained in the trie.
-                        // We now have to remove this leave and then we are done.
-
-                        // delete current_node;
-                        parent_node->delete_child(first_letter);
-
-                        return 1;
-                    } 
-                    else if (lcp == edge_length)        
-                    {
-                        // This means, we can not yet make a decicion weather or not the word is in the trie.
-                        matched_characters = matched_characters + lcp;
-                    }
-                    else {
-                        // This means, that lcp is smaller then both edge_length and suffix_length, so we now that 
-                        // the word is not contained in the trie.
-                        return 0;
-                    }
-                    
-                }
-                
+                release(arena.at_index<Node>(children[i]), arena);
             }
+            arena.deallocate(extra_words(node, arena), block_size(node->nbr_extra_words, count));
+            node->label.release(arena);
+            arena.destroy(node);
+        }
+
+        // The letters of all words get their codes before the build, the most frequent first.
+        void learn(std::span<const std::string_view> elems) { alphabet.learn(elems); }
+
+        void learn(std::string_view text) { alphabet.learn(text); }
 
-            return 0;
+        // The shards of insert_parallel have to use the same codes. All letters are learned before the shards are
+        // made, so they never add a code of their own.
+        FixedSizeNodes shard_policy() const {
+            FixedSizeNodes shard;
+            shard.alphabet = alphabet;
+            return shard;
         }
-};
\ No newline at end of file
+
+        // The blocks are in the nodes of the shards, there is nothing else to take over.
+        void take_over(FixedSizeNodes&) {}
+
+        // The children arrays only hold the children a node has, so the slack is only the rounding of the arena.
+        void account(Node* node, size_t nbr_children, TrieStats& stats) const {
+            size_t used_bytes = block_size(node->nbr_extra_words, nbr_children);
+            size_t block_bytes = Arena::block_bytes(used_bytes);
+            stats.add_node("bitmap_node", Arena::block_bytes(sizeof(Node)) + block_bytes);
+            stats.child_slack_bytes = stats.child_slack_bytes + block_bytes - used_bytes;
+            stats.nbr_word_ends = stats.nbr_word_ends + node->word_end;
+        }
+
+        void account_policy(TrieStats&) const {}
+};
+
+using FixedSizeArrayTrie = RadixTrie<FixedSizeNodes>;
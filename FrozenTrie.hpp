@@ -0,0 +1,268 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Tries.hpp"
+#include "BitVector.hpp"
+#include "TrieImage.hpp"
+
+// A read-only copy of a trie in a succinct layout (LOUDS, level-order unary degree sequence), made by
+// Trie::freeze. It answers contains exactly like the trie it was made from, with a fraction of the memory.
+//
+// The nodes are numbered in breadth first order, the root is node 0. For every node, the bit vector holds
+// one 1 per child and then a 0. So the children of a node are numbered one after another, and their bits
+// start behind the 0 of the node before it:
+//
+//   start = select0(node - 1) + 1,   nbr_children = next_zero(start) - start,
+//   first child = (number of ones before start) + 1 = start - node + 1.
+//
+// There are no pointers at all. Besides the bits, every node only has the first letter of its label in
+// keys (so the children of a node can be searched with one memchr) and the start of its label in the
+// concatenated labels.
+//
+// All arrays are kept in one block of memory in the format of TrieImage.hpp. So save only has to write that
+// block to a file, and a saved file can be memory mapped and used right away.
+class FrozenTrie final : public Trie {
+    private:
+        static const size_t NO_NODE = std::numeric_limits<size_t>::max();
+
+        // The image is either in image_buffer or in mapping.
+        std::vector<uint64_t> image_buffer;
+        std::unique_ptr<trie_image::MappedFile> mapping;
+        const char* image = nullptr;
+        size_t image_size = 0;
+
+        BitVector louds;
+        const char* keys = nullptr;
+        const uint32_t* label_starts = nullptr;   // one more entry for the end of the last label
+        const char* labels = nullptr;
+        size_t nbr_of_nodes = 0;
+
+        size_t find_child(size_t node, char letter) const {
+            size_t start = node == 0 ? 0 : louds.select0(node - 1) + 1;
+            size_t nbr_children = louds.next_zero(start) - start;
+            size_t first_child = start - node + 1;
+
+            const char* found = (const char*) std::memchr(keys + first_child, letter, nbr_children);
+            return found == nullptr ? NO_NODE : found - keys;
+        }
+
+        std::string_view label(size_t node) const {
+            return std::string_view(labels + label_starts[node], label_starts[node + 1] - label_starts[node]);
+        }
+
+        // This function checks the image and lets the arrays point into it.
+        void attach(const char* data, size_t size, bool verify_checksum) {
+            using namespace trie_image;
+            const Header& header = check(data, size, verify_checksum);
+
+            // The sizes of the arrays follow from the number of nodes. If they do not match, a query could
+            // read behind the end of the image.
+            size_t nbr_words = (header.nbr_bits + BitVector::WORD_BITS - 1) / BitVector::WORD_BITS;
+            size_t nbr_blocks = (nbr_words + BitVector::BLOCK_WORDS - 1) / BitVector::BLOCK_WORDS + 1;
+            size_t nbr_samples = (header.nbr_nodes + BitVector::SELECT_SAMPLE - 1) / BitVector::SELECT_SAMPLE;
+            if (header.nbr_nodes == 0
+                || header.nbr_bits != 2 * header.nbr_nodes - 1
+                || header.sections[LOUDS_WORDS].size != nbr_blocks * BitVector::BLOCK_WORDS * sizeof(uint64_t)
+                || header.sections[LOUDS_BLOCK_RANKS].size != (nbr_blocks + 1) * sizeof(uint64_t)
+                || header.sections[LOUDS_ZERO_BLOCKS].size != nbr_samples * sizeof(uint64_t)
+                || header.sections[KEYS].size != header.nbr_nodes
+                || header.sections[LABEL_STARTS].size != (header.nbr_nodes + 1) * sizeof(uint32_t))
+            {
+                throw std::runtime_error("The arrays of the trie image do not fit together");
+            }
+
+            const uint32_t* starts = (const uint32_t*) (data + header.sections[LABEL_STARTS].offset);
+            if (starts[header.nbr_nodes] != header.sections[LABELS].size) throw std::runtime_error("The labels of the trie image do not fit");
+
+            image = data;
+            image_size = size;
+            nbr_of_nodes = header.nbr_nodes;
+            louds = BitVector((const uint64_t*) (data + header.sections[LOUDS_WORDS].offset),
+                              (const uint64_t*) (data + header.sections[LOUDS_BLOCK_RANKS].offset),
+                              (const uint64_t*) (data + header.sections[LOUDS_ZERO_BLOCKS].offset),
+                              header.nbr_bits);
+            keys = data + header.sections[KEYS].offset;
+            label_starts = starts;
+            labels = data + header.sections[LABELS].offset;
+        }
+
+        // This constructor takes over an image, that is already in memory.
+        explicit FrozenTrie(std::vector<uint64_t> buffer) : image_buffer(std::move(buffer)) {
+            attach((const char*) image_buffer.data(), image_buffer.size() * sizeof(uint64_t), false);
+        }
+
+    public:
+        // This constructor copies a trie, starting at its root. label(node) has to return the edge label of a
+        // node and for_each_child(node, f) has to call f for every child.
+        template<class Node, class Label, class ForEachChild>
+        FrozenTrie(Node* root, Label label, ForEachChild for_each_child) {
+            using namespace trie_image;
+
+            BitVectorBuilder louds_builder;
+            std::vector<char> node_keys;
+            std::vector<uint32_t> node_label_starts;
+            std::string node_labels;
+
+            std::vector<Node*> queue;
+            queue.push_back(root);
+
+            for (size_t i = 0; i < queue.size(); i++)
+            {
+                Node* node = queue[i];
+                std::string_view node_label = label(node);
+
+                node_keys.push_back(letter_at(node_label, 0));
+                node_label_starts.push_back(node_labels.length());
+                node_labels.append(node_label);
+
+                for_each_child(node, [&](Node* child) {
+                    queue.push_back(child);
+                    louds_builder.push_back(1);
+                });
+                louds_builder.push_back(0);
+            }
+
+            if (node_labels.length() > std::numeric_limits<uint32_t>::max()) throw std::length_error("The labels are too long for a frozen trie");
+            node_label_starts.push_back(node_labels.length());
+            louds_builder.build();
+
+            // Now every array is copied to its place in the image.
+            Header header = {};
+            std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            header.format_version = FORMAT_VERSION;
+            header.byte_order = BYTE_ORDER_MARK;
+            header.nbr_nodes = node_keys.size();
+            header.nbr_bits = louds_builder.nbr_bits;
+
+            const void* arrays[NBR_SECTIONS] = {louds_builder.words.data(), louds_builder.block_ranks.data(), louds_builder.zero_blocks.data(),
+                                                node_keys.data(), node_label_starts.data(), node_labels.data()};
+            size_t sizes[NBR_SECTIONS] = {louds_builder.words.size() * sizeof(uint64_t), louds_builder.block_ranks.size() * sizeof(uint64_t),
+                                          louds_builder.zero_blocks.size() * sizeof(uint64_t), node_keys.size(),
+                                          node_label_starts.size() * sizeof(uint32_t), node_labels.length()};
+
+            size_t offset = PAYLOAD_OFFSET;
+            for (size_t section = 0; section < NBR_SECTIONS; section++)
+            {
+                header.sections[section] = SectionEntry{offset, sizes[section]};
+                offset = (offset + sizes[section] + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+            }
+            header.file_size = offset;
+
+            image_buffer.assign(offset / sizeof(uint64_t), 0);
+            char* data = (char*) image_buffer.data();
+            for (size_t section = 0; section < NBR_SECTIONS; section++)
+            {
+                if (sizes[section] > 0) std::memcpy(data + header.sections[section].offset, arrays[section], sizes[section]);
+            }
+
+            header.payload_checksum = checksum(data + PAYLOAD_OFFSET, offset - PAYLOAD_OFFSET);
+            header.header_checksum = header_checksum(header);
+            std::memcpy(data, &header, sizeof(Header));
+
+            attach(data, offset, false);
+        }
+
+        // This constructor opens an image, that was written by save, and uses it in place. The checksum over the
+        // arrays has to read the whole file, so it can be turned off for the fastest start.
+        explicit FrozenTrie(const std::string& file_name, bool verify_checksum = true)
+            : mapping(std::make_unique<trie_image::MappedFile>(file_name)) {
+            attach(mapping->data(), mapping->size(), verify_checksum);
+        }
+
+        FrozenTrie(const FrozenTrie&) = delete;
+        FrozenTrie& operator=(const FrozenTrie&) = delete;
+
+        // This function writes the image to a file, from which it can be opened again.
+        void save(const std::string& file_name) const {
+            std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+            file.write(image, image_size);
+            file.close();
+            if (!file) throw std::runtime_error("The trie image " + file_name + " can not be written");
+        }
+
+        bool contains(std::string_view elem) const override {
+            size_t matched_characters = 0;
+            size_t current_node = 0;
+
+            while (true)
+            {
+                size_t next_node = find_child(current_node, letter_at(elem, matched_characters));
+
+                if (next_node == NO_NODE)
+                {
+                    // There is no edge with the first letter of our unmatched suffix. Therefore, the word is not
+                    // in the trie and we can return false.
+                    return 0;
+                }
+
+                // We now step into the next node and compare the suffix of our word with the edge of that node.
+                current_node = next_node;
+                std::string_view edge_label = label(current_node);
+
+                size_t lcp = lcp_function(elem.substr(matched_characters), edge_label);
+                size_t suffix_length = elem.length() - matched_characters;
+
+                if (lcp == suffix_length)
+                {
+                    // This means, we reached a leave and therefore the element is contained in the trie.
+                    return 1;
+                }
+                else if (lcp == edge_label.length())
+                {
+                    // This means, we can not yet make a decicion weather or not the word is contained in the trie.
+                    matched_characters = matched_characters + lcp;
+                }
+                else
+                {
+                    // This means, that lcp is smaller then both edge_length and suffix_length, so we now that
+                    // the word is not contained in the trie.
+                    return 0;
+                }
+            }
+        }
+
+        bool insert(std::string_view) override {
+            throw std::logic_error("A frozen trie can not be changed");
+        }
+
+        bool delete_elem(std::string_view) override {
+            throw std::logic_error("A frozen trie can not be changed");
+        }
+
+        std::unique_ptr<FrozenTrie> freeze() const override {
+            std::vector<uint64_t> buffer((image_size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+            std::memcpy(buffer.data(), image, image_size);
+            return std::unique_ptr<FrozenTrie>(new FrozenTrie(std::move(buffer)));
+        }
+
+        // The image has no nodes of their own, so all nodes are counted as one type with the bytes of the image
+        // besides the labels. A frozen trie does not know, which inner nodes were word ends, so only the leaves
+        // are counted as word ends.
+        TrieStats stats() const override {
+            TrieStats stats = collect_stats<size_t>(0,
+                [this](size_t node, auto f) {
+                    size_t start = node == 0 ? 0 : louds.select0(node - 1) + 1;
+                    size_t nbr_children = louds.next_zero(start) - start;
+                    for (size_t i = 0; i < nbr_children; i++) f(start - node + 1 + i);
+                },
+                [](size_t, size_t nbr_children, TrieStats& stats) {
+                    stats.node_types["louds_node"].count++;
+                    stats.nbr_word_ends = stats.nbr_word_ends + (nbr_children == 0);
+                });
+            stats.label_bytes = label_starts[nbr_of_nodes];
+            stats.node_types["louds_node"].bytes = image_size - stats.label_bytes;
+            return stats;
+        }
+
+        size_t nbr_nodes() const { return nbr_of_nodes; }
+
+        size_t memory_bytes() const { return image_size; }
+};
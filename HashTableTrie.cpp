@@ -1,224 +1,92 @@
-#include "Tries.hpp"
-#include <iostream>
-#include <unordered_map>
+#include "RadixTrie.hpp"
+#include "EdgeTable.hpp"
 
-class HashTableTrie : public Trie {
+// The node policy of HashTableTrie (see RadixTrie.hpp). A node is only its label, a few flags and the bitmap of
+// the letters of its children (see EdgeTable::letter_bit). Its edges to the children are all kept in the edge
+// table of the policy, under the arena index of the node and the first letter of the child.
+class HashTableNodes {
     private:
+        EdgeTable edges;
+
+    public:
         struct Node {
-            private:
-                int8_t nbr_children = 0;
-                std::unordered_map<char, Node*> children;
-
-            public: 
-                std::string comp_edge_label;
-
-                Node(std::string edge_label) { comp_edge_label = edge_label; }
-
-                // This function adds a child to the node and stores a pointer to it.
-                void add_child(Node* child_ptr) {
-                    char first_letter = child_ptr->comp_edge_label[0];
-                    if(children.find(first_letter) == children.end()) {
-                        children[first_letter] = child_ptr;
-                    }
-                }
-
-                // This function checks if there is an edge to a child, that begins with a given letter.
-                Node* find_child(char letter) {
-                    if (children.find(letter) != children.end())
-                    {
-                        return children[letter];
-                    }
-                    return nullptr;
-                }
-
-                // This functions delets the child, whoms edge starts with the given letter.
-                void delete_child(char letter) {
-                    children.erase(letter);
-                }
-        };
+            EdgeLabel label;
+            uint64_t letter_bits = 0;   // the bits of the first letters of the children
+            bool word_end;              // if a word ends at the end of the label (and not only passes through)
+            uint16_t nbr_children = 0;
 
-        Node *root = new Node("");
+            Node(EdgeLabel edge_label, bool word_end, Arena&) : label(edge_label), word_end(word_end) {}
 
-    public:
+            Node(std::string_view edge_label, bool word_end, Arena& arena) : Node(EdgeLabel(edge_label, arena), word_end, arena) {}
+        };
 
-        bool insert(std::string &elem) override {
-            size_t matched_characters = 0;
-            Node* current_node = root;
-            Node* parent_node;
-            Node* new_leave_node;
-            Node* next_node;
-            char first_letter;
+        size_t nbr_children(Node* node, const Arena&) const { return node->nbr_children; }
 
-            while (true)        
-            {
-                first_letter = elem[matched_characters];
-                next_node = current_node->find_child(first_letter);
-
-                if (next_node == nullptr)
-                {   
-                    // There is no edge with the first letter of our unmatched suffix. Therefore, the word is not
-                    // in the trie and we can add it here.
-                    current_node->add_child(new Node(elem.substr(matched_characters)));
-                    return 1;
-                }
-                else
-                {
-                    // We now step into the next node and compare the suffix of our word with the edge of that node.
-                    parent_node = current_node;
-                    current_node = next_node;
-
-                    size_t lcp = lcp_function(elem.substr(matched_characters), current_node->comp_edge_label);
-                    size_t suffix_length = elem.length() - matched_characters;
-                    size_t edge_length = current_node->comp_edge_label.length();
-
-                    if (lcp == suffix_length)
-                    {   
-                        // This means, we reached a leave and therefore the element was alredy in the trie.
-                        return 0;
-                    } 
-                    else if (lcp == edge_length)        
-                    {
-                        // This means, we can not yet make a decicion weather or not the word is in the trie.
-                        matched_characters = matched_characters + lcp;
-                    }
-                    else {
-                        // This means, that lcp is smaller then both edge_length and suffix_length, so we now that 
-                        // the word is not in the trie and we can insert it here.
-                        //
-                        // For that, we now have to split the current_node at lcp and make two child nodes.
-                        // One of the two new nodes will be the a leave (no children) and on its edge we write the 
-                        // unmatched suffix of our word. The other will have the unmatched suffix of the edge label 
-                        // and its children are going to be the children of the current node.
-
-                        // Create new leave and name it accordingly.
-                        new_leave_node = new Node(elem.substr(matched_characters + lcp));
-
-                        // Create new intermediate node and name it accordingly.
-                        current_node = new Node(current_node->comp_edge_label.substr(0,lcp));
-
-                        // Rename the label of the next_node accordingly.
-                        next_node->comp_edge_label = next_node->comp_edge_label.substr(lcp);
-
-                        // Make this new intermediate node the child of the parent_node.
-                        parent_node->delete_child(first_letter);
-                        parent_node->add_child(current_node);
-
-                        // Set the children of the new intermediate node.
-                        current_node->add_child(next_node);
-                        current_node->add_child(new_leave_node); 
-
-                        return 1;
-                    }
-                    
-                }
-                
-            }
+        // This function checks if there is an edge to a child of node, that begins with a given letter.
+        Node* find_child(Node* node, char letter, const Arena& arena) const {
+            return arena.at_index<Node>(edges.find(arena.index_of(node), letter));
+        }
+
+        // This function calls f for every child of the node. Only the letters in its bitmap are looked up.
+        template<class F>
+        void for_each_child(Node* node, const Arena& arena, F f) const {
+            edges.for_each_child(arena.index_of(node), node->letter_bits, [&](uint32_t child) { f(arena.at_index<Node>(child)); });
+        }
 
-            return 0;
+        // This function adds a child to the node, the node must not have a child with the same first letter.
+        void add_child(Node* node, Node* child, Arena& arena) {
+            edges.insert(arena.index_of(node), child->label.first(), arena.index_of(child));
+            node->letter_bits = node->letter_bits | EdgeTable::letter_bit(child->label.first());
+            node->nbr_children++;
         }
 
-        bool contains(std::string& elem) const override {
-            size_t matched_characters = 0;
-            Node* current_node = root;
-            Node* next_node;
-            char first_letter;
+        // This functions delets the edge to the child, whoms edge starts with the given letter.
+        void delete_child(Node* node, char letter, Arena& arena) {
+            edges.erase(arena.index_of(node), letter);
+            if (!edges.shares_letter_bit(arena.index_of(node), letter)) node->letter_bits = node->letter_bits & ~EdgeTable::letter_bit(letter);
+            node->nbr_children--;
+        }
 
-            while (true)        
+        // This function gives the node, its label and all of its descendants back to the arena and removes their
+        // edges.
+        void release(Node* node, Arena& arena) {
+            std::vector<Node*> children;
+            for_each_child(node, arena, [&](Node* child) { children.push_back(child); });
+            for (Node* child : children)
             {
-                first_letter = elem[matched_characters];
-                next_node = current_node->find_child(first_letter);
-
-                if (next_node == nullptr)
-                {   
-                    // There is no edge with the first letter of our unmatched suffix. Therefore, the word is not
-                    // in the trie and we can return false. 
-                    return 0;
-                }
-                else
-                {
-                    // We now step into the next node and compare the suffix of our word with the edge of that node.
-                    current_node = next_node;
-
-                    size_t lcp = lcp_function(elem.substr(matched_characters), current_node->comp_edge_label);
-                    size_t suffix_length = elem.length() - matched_characters;
-                    size_t edge_length = current_node->comp_edge_label.length();
-
-                    if (lcp == suffix_length)
-                    {   
-                        // This means, we reached a leave and therefore the element is contained in the trie.
-                        return 1;
-                    } 
-                    else if (lcp == edge_length)        
-                    {
-                        // This means, we can not yet make a decicion weather or not the word is contained in the trie.
-                        matched_characters = matched_characters + lcp;
-                    }
-                    else {
-                        // This means, that lcp is smaller then both edge_length and suffix_length, so we now that 
-                        // the word is not contained in the trie.
-                        return 0;
-                    }
-                    
-                }
-                
+                delete_child(node, child->label.first(), arena);
+                release(child, arena);
             }
-
-            return 0;
+            node->label.release(arena);
+            arena.destroy(node);
         }
 
-        bool delete_elem(std::string& elem) override{
-            size_t matched_characters = 0;
-            Node* current_node = root;
-            Node* parent_node;
-            Node* next_node;
-            char first_letter;
+        // The children are found by their letters as they are, so there is nothing to learn.
+        void learn(std::span<const std::string_view>) {}
 
-            while (true)        
-            {
-                first_letter = elem[matched_characters];
-                next_node = current_node->find_child(first_letter);
-
-                if (next_node == nullptr)
-                {   
-                    // There is no edge with the first letter of our unmatched suffix. Therefore, the word is not
-                    // in the trie and we can return false.   
-                    return 0;
-                }
-                else
-                {
-                    // We now step into the next node and compare the suffix of our word with the edge of that node.
-                    parent_node = current_node;
-                    current_node = next_node;
-
-                    size_t lcp = lcp_function(elem.substr(matched_characters), current_node->comp_edge_label);
-                    size_t suffix_length = elem.length() - matched_characters;
-                    size_t edge_length = current_node->comp_edge_label.length();
-
-                    if (lcp == suffix_length)
-                    {   
-                        // This means, we reached a leave and therefore the element was contained in the trie.
-                        // We now have to remove this leave and then we are done.
-
-                        // delete current_node;
-                        parent_node->delete_child(first_letter);
-
-                        return 1;
-                    } 
-                    else if (lcp == edge_length)        
-                    {
-                        // This means, we can not yet make a decicion weather or not the word is in the trie.
-                        matched_characters = matched_characters + lcp;
-                    }
-                    else {
-                        // This means, that lcp is smaller then both edge_length and suffix_length, so we now that 
-                        // the word is not contained in the trie.
-                        return 0;
-                    }
-                    
-                }
-                
-            }
+        void learn(std::string_view) {}
+
+        // A shard starts with an empty edge table of its own.
+        HashTableNodes shard_policy() const { return HashTableNodes(); }
 
-            return 0;
+        // The shards have edge tables of their own. Their nodes are in the same range as the ones of this trie,
+        // so their edges can be moved over as they are.
+        void take_over(HashTableNodes& shard) {
+            shard.edges.for_each_edge([&](uint32_t parent, char letter, uint32_t child) { edges.insert(parent, letter, child); });
+            shard.edges.clear();
         }
-};
\ No newline at end of file
+
+        void account(Node* node, size_t, TrieStats& stats) const {
+            stats.add_node("hash_node", Arena::block_bytes(sizeof(Node)));
+            stats.nbr_word_ends = stats.nbr_word_ends + node->word_end;
+        }
+
+        // The edge table is counted as a node type of its own, its empty slots are the slack.
+        void account_policy(TrieStats& stats) const {
+            stats.node_types["edge_table"].count = 1;
+            stats.node_types["edge_table"].bytes = edges.memory_bytes();
+            stats.child_slack_bytes = (edges.capacity() - edges.size()) * edges.slot_bytes();
+        }
+};
+
+using HashTableTrie = RadixTrie<HashTableNodes>;
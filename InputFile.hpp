@@ -0,0 +1,153 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// This class reads a text file line by line without copying the lines.
+//
+// A regular file is mapped into memory as a whole, and every line is a view straight into that mapping,
+// which stays valid as long as the InputFile exists. Anything that can not be mapped (a pipe, a terminal,
+// ...) is read with read() into a buffer instead. In that case a line is a view into the buffer and is only
+// valid until the next call of next_line.
+//
+// Lines are split exactly like getline does it: at every '\n', and a last line without '\n' is returned
+// as well.
+class InputFile {
+    private:
+        static const size_t READ_SIZE = 1 << 20;
+
+        int fd = -1;
+
+        // The mapping of a regular file.
+        const char* mapping = nullptr;
+        size_t mapping_size = 0;
+
+        // The buffer for everything else. The bytes from buffer_begin to buffer_end are not returned yet.
+        std::vector<char> buffer;
+        size_t buffer_begin = 0;
+        size_t buffer_end = 0;
+        bool end_of_stream = false;
+
+        // The position of the next line in the mapping.
+        const char* position = nullptr;
+        const char* end = nullptr;
+
+        bool next_mapped_line(std::string_view& line) {
+            if (position == end) return false;
+
+            const char* newline = (const char*) std::memchr(position, '\n', end - position);
+            const char* line_end = newline == nullptr ? end : newline;
+            line = std::string_view(position, line_end - position);
+            position = newline == nullptr ? end : newline + 1;
+            return true;
+        }
+
+        bool next_streamed_line(std::string_view& line) {
+            while (true)
+            {
+                const char* begin = buffer.data() + buffer_begin;
+                const char* newline = (const char*) std::memchr(begin, '\n', buffer_end - buffer_begin);
+                if (newline != nullptr)
+                {
+                    line = std::string_view(begin, newline - begin);
+                    buffer_begin = newline - buffer.data() + 1;
+                    return true;
+                }
+
+                if (end_of_stream)
+                {
+                    if (buffer_begin == buffer_end) return false;
+                    line = std::string_view(begin, buffer_end - buffer_begin);
+                    buffer_begin = buffer_end;
+                    return true;
+                }
+
+                // Move the incomplete line to the front of the buffer (or grow the buffer if the line fills
+                // it completely) and read more.
+                std::memmove(buffer.data(), begin, buffer_end - buffer_begin);
+                buffer_end = buffer_end - buffer_begin;
+                buffer_begin = 0;
+                if (buffer.size() - buffer_end < READ_SIZE) buffer.resize(buffer_end + READ_SIZE);
+
+                ssize_t nbr_bytes = read(fd, buffer.data() + buffer_end, buffer.size() - buffer_end);
+                if (nbr_bytes <= 0) end_of_stream = true;
+                else buffer_end = buffer_end + nbr_bytes;
+            }
+        }
+
+    public:
+        explicit InputFile(const std::string& file_name) {
+            fd = open(file_name.c_str(), O_RDONLY);
+            if (fd < 0) return;
+
+            struct stat file_stat;
+            if (fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode))
+            {
+                mapping_size = file_stat.st_size;
+                if (mapping_size == 0)
+                {
+                    // An empty file can not be mapped, but it has no lines anyway.
+                    position = end = nullptr;
+                    mapping = "";
+                    return;
+                }
+
+                void* ptr = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (ptr != MAP_FAILED)
+                {
+                    // We read the file once from the front to the back, so the kernel can read ahead
+                    // aggressively and drop pages behind us.
+                    madvise(ptr, mapping_size, MADV_SEQUENTIAL);
+                    mapping = (const char*) ptr;
+                    position = mapping;
+                    end = mapping + mapping_size;
+                    return;
+                }
+                mapping_size = 0;
+            }
+
+            buffer.resize(READ_SIZE);
+        }
+
+        ~InputFile() {
+            if (mapping != nullptr && mapping_size > 0) munmap((void*) mapping, mapping_size);
+            if (fd >= 0) close(fd);
+        }
+
+        InputFile(const InputFile&) = delete;
+        InputFile& operator=(const InputFile&) = delete;
+
+        bool is_open() const { return fd >= 0; }
+
+        // True if the lines stay valid until the InputFile is destroyed, and not only until the next call.
+        bool is_mapped() const { return mapping != nullptr; }
+
+        // The whole file, if it is mapped, and an empty view otherwise.
+        std::string_view contents() const { return mapping != nullptr ? std::string_view(mapping, mapping_size) : std::string_view(); }
+
+        // This function stores the next line (without its '\n') in line. It returns false at the end of the file.
+        bool next_line(std::string_view& line) {
+            if (mapping != nullptr) return next_mapped_line(line);
+            return next_streamed_line(line);
+        }
+};
+
+// This function splits a querry line "<word> <querry_type>" at its first space, like main.cpp always did.
+// If there is no space, the whole line is taken as both the word and the querry type.
+inline void split_querry(std::string_view line, std::string_view& word, std::string_view& querry_type) {
+    const char* space = (const char*) std::memchr(line.data(), ' ', line.length());
+    if (space == nullptr)
+    {
+        word = line;
+        querry_type = line;
+        return;
+    }
+    word = line.substr(0, space - line.data());
+    querry_type = line.substr(space - line.data() + 1);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// A histogram of latencies in nanoseconds with logarithmic buckets, like a HDR histogram.
+//
+// Values below 2 * SUB_BUCKETS get a bucket of their own. Above, every power of two is split into SUB_BUCKETS
+// buckets of equal width, so a bucket is at most 1/SUB_BUCKETS (about 3%) wider than its values. Recording a
+// value is a bit scan and an increment, and the whole range of uint64_t fits into 1920 counters.
+class LatencyHistogram {
+    private:
+        static const size_t SUB_BUCKET_BITS = 5;
+        static const size_t SUB_BUCKETS = (size_t) 1 << SUB_BUCKET_BITS;
+        static const size_t NBR_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+        std::vector<uint64_t> buckets;
+        uint64_t nbr_values = 0;
+        uint64_t max_value = 0;
+
+        static size_t bucket_of(uint64_t value) {
+            if (value < 2 * SUB_BUCKETS) return value;
+            size_t shift = (63 - __builtin_clzll(value)) - SUB_BUCKET_BITS;
+            return shift * SUB_BUCKETS + (value >> shift);
+        }
+
+        // This function returns the highest value, that falls into the bucket.
+        static uint64_t highest_value_of(size_t bucket) {
+            if (bucket < 2 * SUB_BUCKETS) return bucket;
+            size_t shift = bucket / SUB_BUCKETS - 1;
+            uint64_t sub_bucket = bucket % SUB_BUCKETS + SUB_BUCKETS;
+            return ((sub_bucket + 1) << shift) - 1;
+        }
+
+    public:
+        LatencyHistogram() : buckets(NBR_BUCKETS, 0) {}
+
+        void record(uint64_t nanoseconds) {
+            buckets[bucket_of(nanoseconds)]++;
+            nbr_values++;
+            max_value = std::max(max_value, nanoseconds);
+        }
+
+        uint64_t count() const { return nbr_values; }
+
+        uint64_t max() const { return max_value; }
+
+        // This function returns the latency, that percent of the values do not exceed. It is the highest value
+        // of the bucket, so it is never too low, and at most about 3% too high.
+        uint64_t percentile(double percent) const {
+            if (nbr_values == 0) return 0;
+            uint64_t rank = std::max<uint64_t>(1, (uint64_t) std::ceil(percent / 100 * nbr_values));
+            uint64_t seen = 0;
+            for (size_t bucket = 0; bucket < NBR_BUCKETS; bucket++)
+            {
+                seen = seen + buckets[bucket];
+                if (seen >= rank) return std::min(highest_value_of(bucket), max_value);
+            }
+            return max_value;
+        }
+};
+
+// This class keeps one latency histogram for each querry type (c, d and i).
+//
+// With a sample rate of n, only every n-th querry is timed, so that reading the clock costs next to nothing
+// for short querries, and the querries in between can still be run in batches. The timed querries are spread
+// evenly over the file, so the percentiles stay the same.
+class LatencyRecorder {
+    private:
+        LatencyHistogram histograms[3];
+        size_t sample_rate;
+        size_t until_next_sample;
+
+        static size_t index_of(char querry_type) {
+            if (querry_type == 'c') return 0;
+            if (querry_type == 'd') return 1;
+            return 2;
+        }
+
+    public:
+        explicit LatencyRecorder(size_t sample_rate = 1) : sample_rate(std::max<size_t>(sample_rate, 1)), until_next_sample(1) {}
+
+        // This function decides, if the next querry is timed. It has to be called once for every querry.
+        bool sample() {
+            if (--until_next_sample != 0) return 0;
+            until_next_sample = sample_rate;
+            return 1;
+        }
+
+        // This function runs the querry f, records its latency and returns its result.
+        template<class F>
+        bool measure(char querry_type, F f) {
+            auto start = std::chrono::steady_clock::now();
+            bool result = f();
+            auto end = std::chrono::steady_clock::now();
+            histograms[index_of(querry_type)].record(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            return result;
+        }
+
+        const LatencyHistogram& histogram(char querry_type) const { return histograms[index_of(querry_type)]; }
+
+        // This function prints the number of timed querries and p50, p99, p999 and the maximum of every querry type,
+        // that was timed at all, as key=value pairs for the RESULT line of main.cpp.
+        void print(std::ostream& out) const {
+            for (char querry_type : {'c', 'd', 'i'})
+            {
+                const LatencyHistogram& h = histogram(querry_type);
+                if (h.count() == 0) continue;
+                out << " " << querry_type << "_sampled=" << h.count()
+                    << " " << querry_type << "_p50=" << h.percentile(50) << "ns"
+                    << " " << querry_type << "_p99=" << h.percentile(99) << "ns"
+                    << " " << querry_type << "_p999=" << h.percentile(99.9) << "ns"
+                    << " " << querry_type << "_max=" << h.max() << "ns";
+            }
+        }
+};
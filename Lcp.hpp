@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Kernels for the longest common prefix of two byte strings with n bytes each. They all return the
+// position of the first byte that differs, or n if there is none.
+//
+// lcp_function runs at every node of every operation, and our edge labels are often long, so comparing
+// one byte per iteration is too slow. The kernels below compare 8, 16 or 32 bytes at a time and find the
+// first differing byte with a single count-trailing-zeros on the mismatch mask. None of them reads a
+// byte behind position n.
+
+// The reference implementation, one byte per iteration.
+inline size_t lcp_scalar(const char* str1, const char* str2, size_t n) {
+    size_t i = 0;
+    while (i < n && str1[i] == str2[i]) {
+        i++;
+    }
+    return i;
+}
+
+// Compares 8 bytes at a time as one 64 bit word. The xor of the two words has its lowest set bit in the
+// first differing byte (on little endian machines, on big endian it is the highest one).
+inline size_t lcp_word(const char* str1, const char* str2, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        uint64_t word1, word2;
+        std::memcpy(&word1, str1 + i, 8);
+        std::memcpy(&word2, str2 + i, 8);
+        uint64_t diff = word1 ^ word2;
+        if (diff != 0)
+        {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            return i + (__builtin_clzll(diff) >> 3);
+#else
+            return i + (__builtin_ctzll(diff) >> 3);
+#endif
+        }
+    }
+    return i + lcp_scalar(str1 + i, str2 + i, n - i);
+}
+
+#if defined(__SSE2__)
+// Compares 16 bytes at a time. SSE2 is part of every x86-64 cpu, so this is our baseline.
+inline size_t lcp_sse2(const char* str1, const char* str2, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i block1 = _mm_loadu_si128((const __m128i*) (str1 + i));
+        __m128i block2 = _mm_loadu_si128((const __m128i*) (str2 + i));
+        unsigned mismatch = _mm_movemask_epi8(_mm_cmpeq_epi8(block1, block2)) ^ 0xFFFF;
+        if (mismatch != 0) return i + __builtin_ctz(mismatch);
+    }
+    return i + lcp_word(str1 + i, str2 + i, n - i);
+}
+
+// Compares 32 bytes at a time. The function is compiled for AVX2 no matter which flags the rest of the
+// program uses, so it may only be called after checking that the cpu supports it.
+__attribute__((target("avx2")))
+inline size_t lcp_avx2(const char* str1, const char* str2, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i block1 = _mm256_loadu_si256((const __m256i*) (str1 + i));
+        __m256i block2 = _mm256_loadu_si256((const __m256i*) (str2 + i));
+        unsigned mismatch = ~(unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(block1, block2));
+        if (mismatch != 0) return i + __builtin_ctz(mismatch);
+    }
+    return i + lcp_sse2(str1 + i, str2 + i, n - i);
+}
+#endif
+
+using LcpKernel = size_t (*)(const char*, const char*, size_t);
+
+// This function picks the widest kernel the cpu supports. It runs once, when the program starts.
+inline LcpKernel select_lcp_kernel() {
+#if defined(__SSE2__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return lcp_avx2;
+    return lcp_sse2;
+#else
+    return lcp_word;
+#endif
+}
+
+inline const LcpKernel lcp_long_kernel = select_lcp_kernel();
+
+// This is the kernel the tries use. Short strings are compared inline, only for long ones the call
+// through the pointer to the selected kernel pays off.
+inline size_t lcp_fast(const char* str1, const char* str2, size_t n) {
+    if (n < 16) return lcp_word(str1, str2, n);
+#if defined(__SSE2__)
+    if (n < 32) return lcp_sse2(str1, str2, n);
+#endif
+    return lcp_long_kernel(str1, str2, n);
+}
@@ -0,0 +1,617 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <cstdlib>
+#include <cstdint>
+#include <random>
+#include <algorithm>
+#include <span>
+#include <thread>
+#include <malloc.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <filesystem>
+#include <cstring>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "InputFile.hpp"
+#include "Tries.hpp"
+#include "FixedSize.cpp"
+#include "VariableSizeTrie.cpp"
+#include "HashTableTrie.cpp"
+#include "AdaptiveRadixTrie.cpp"
+#include "ConcurrentTrie.cpp"
+#include "BurstTrie.cpp"
+
+// Small benchmarks for single trie operations. Usage:
+//
+//   ti_microbench allocations <input_file>
+//   ti_microbench lcp
+//   ti_microbench batch <input_file>
+//   ti_microbench concurrent <input_file> [max_threads]
+//   ti_microbench freeze <input_file>
+//   ti_microbench coldstart <input_file>
+//   ti_microbench memory <input_file>
+//   ti_microbench churn <input_file>
+//   ti_microbench cachemisses <input_file>
+//   ti_microbench dispatch <input_file>
+//
+// Every benchmark prints one "BENCH" line per trie variant with key=value pairs.
+
+// Every call of the global operator new is counted, so that a benchmark can check how many heap
+// allocations an operation needs. All forms of new (plain, array and aligned) are replaced and take their
+// memory from malloc, and all forms of delete give it back with free, so that no block from one allocator ends
+// up in the other. They are never inlined: the compiler would otherwise see free on a pointer from new at the
+// call sites and warn about it (-Wmismatched-new-delete), although the pair matches.
+static size_t allocation_count = 0;
+
+static void* counted_allocation(size_t size, size_t alignment) {
+    allocation_count++;
+    if (size == 0) size = 1;
+    void* ptr;
+    if (alignment <= alignof(std::max_align_t)) ptr = std::malloc(size);
+    else ptr = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+
+__attribute__((noinline)) void* operator new(size_t size) { return counted_allocation(size, 0); }
+__attribute__((noinline)) void* operator new[](size_t size) { return counted_allocation(size, 0); }
+__attribute__((noinline)) void* operator new(size_t size, std::align_val_t alignment) { return counted_allocation(size, (size_t) alignment); }
+__attribute__((noinline)) void* operator new[](size_t size, std::align_val_t alignment) { return counted_allocation(size, (size_t) alignment); }
+
+__attribute__((noinline)) void operator delete(void* ptr) noexcept { std::free(ptr); }
+__attribute__((noinline)) void operator delete[](void* ptr) noexcept { std::free(ptr); }
+__attribute__((noinline)) void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+__attribute__((noinline)) void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+__attribute__((noinline)) void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+__attribute__((noinline)) void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+__attribute__((noinline)) void operator delete(void* ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+__attribute__((noinline)) void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+static std::vector<std::pair<std::string, std::unique_ptr<Trie>>> make_tries() {
+    std::vector<std::pair<std::string, std::unique_ptr<Trie>>> tries;
+    tries.emplace_back("fixed_size_array_trie", std::make_unique<FixedSizeArrayTrie>());
+    tries.emplace_back("variable_size_array_trie", std::make_unique<VariableSizeArrayTrie>());
+    tries.emplace_back("hash_table_trie", std::make_unique<HashTableTrie>());
+    tries.emplace_back("adaptive_radix_trie", std::make_unique<AdaptiveRadixTrie>());
+    tries.emplace_back("concurrent_trie", std::make_unique<ConcurrentTrie>());
+    tries.emplace_back("burst_trie", std::make_unique<BurstTrie>());
+    return tries;
+}
+
+static std::vector<std::string> read_lines(const char* file_name) {
+    std::ifstream file(file_name);
+    if (!file) throw std::invalid_argument("The input_file " + std::string(file_name) + " does not exist!");
+
+    std::vector<std::string> lines;
+    std::string line;
+    while (getline(file, line)) lines.push_back(line);
+    return lines;
+}
+
+// This benchmark builds every variant from the input file and then looks up every key once (a hit) and
+// every key with its last letter changed once (mostly misses). It reports the heap allocations made
+// during the lookups, which should be zero.
+static void bench_allocations(const std::vector<std::string>& keys) {
+    std::vector<std::string> misses = keys;
+    for (std::string& key : misses)
+    {
+        if (!key.empty()) key.back() = key.back() == 'a' ? 'b' : 'a';
+    }
+
+    for (auto& [variant, trie] : make_tries())
+    {
+        for (const std::string& key : keys) trie->insert(key);
+
+        size_t found = 0;
+        size_t allocations_before = allocation_count;
+        auto start = std::chrono::steady_clock::now();
+
+        for (const std::string& key : keys) found += trie->contains(key);
+        for (const std::string& key : misses) found += trie->contains(key);
+
+        auto end = std::chrono::steady_clock::now();
+        size_t allocations = allocation_count - allocations_before;
+        size_t nbr_lookups = keys.size() + misses.size();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+        std::cout << "BENCH allocations"
+                  << " variant=" << variant
+                  << " contains=" << nbr_lookups
+                  << " found=" << found
+                  << " allocations=" << allocations
+                  << " allocations_per_contains=" << (double) allocations / nbr_lookups
+                  << " ns_per_contains=" << ns / nbr_lookups << std::endl;
+    }
+}
+
+// This benchmark measures every lcp kernel on strings that match completely. That the kernels are right for
+// every length and mismatch position is checked by ti_tests.
+static void bench_lcp() {
+    std::vector<std::pair<std::string, LcpKernel>> kernels;
+    kernels.emplace_back("scalar", lcp_scalar);
+    kernels.emplace_back("word", lcp_word);
+#if defined(__SSE2__)
+    kernels.emplace_back("sse2", lcp_sse2);
+    if (__builtin_cpu_supports("avx2")) kernels.emplace_back("avx2", lcp_avx2);
+#endif
+    kernels.emplace_back("fast", lcp_fast);
+
+    std::mt19937 random(42);
+    std::string str1(300, 0);
+    for (char& c : str1) c = 'a' + random() % 26;
+
+    for (size_t length : {8, 32, 128, 1024})
+    {
+        std::string str2 = str1;
+        while (str2.length() < length) str2 += str2;
+        str2.resize(length);
+        std::string copy = str2;
+
+        for (auto& [name, kernel] : kernels)
+        {
+            const size_t repetitions = 10000000 / length + 1000;
+            size_t sum = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < repetitions; i++)
+            {
+                sum += kernel(str2.data(), copy.data(), length);
+                asm volatile("" : "+r"(sum));
+            }
+            auto end = std::chrono::steady_clock::now();
+            double ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+            std::cout << "BENCH lcp"
+                      << " kernel=" << name
+                      << " length=" << length
+                      << " ns_per_call=" << ns / repetitions
+                      << " bytes_per_ns=" << length * repetitions / ns << std::endl;
+        }
+    }
+}
+
+// This benchmark builds every variant from the input file and looks up all keys (in random order) and
+// as many misses, once with single contains calls and then with contains_batch and contains_sorted for growing
+// batch sizes. 4096 is the size of the batches of the querry pipeline.
+static void bench_batch(const std::vector<std::string>& keys) {
+    std::vector<std::string> words = keys;
+    for (const std::string& key : keys)
+    {
+        std::string miss = key;
+        if (!miss.empty()) miss.back() = miss.back() == 'a' ? 'b' : 'a';
+        words.push_back(miss);
+    }
+    std::shuffle(words.begin(), words.end(), std::mt19937(42));
+    std::vector<std::string_view> views(words.begin(), words.end());
+
+    for (auto& [variant, trie] : make_tries())
+    {
+        for (const std::string& key : keys) trie->insert(key);
+
+        for (size_t batch_size : {0, 1, 2, 4, 8, 16, 32, 64, 256, 4096})
+        for (bool sorted : {false, true})
+        {
+            if (batch_size == 0 && sorted) continue;
+
+            std::vector<bool> results;
+            size_t found = 0;
+            auto start = std::chrono::steady_clock::now();
+
+            if (batch_size == 0)
+            {
+                // Batch size 0 stands for the plain contains loop.
+                for (std::string_view word : views) found += trie->contains(word);
+            }
+            else
+            {
+                for (size_t i = 0; i < views.size(); i += batch_size)
+                {
+                    size_t count = std::min(batch_size, views.size() - i);
+                    std::span<const std::string_view> batch = std::span<const std::string_view>(views).subspan(i, count);
+                    if (sorted) trie->contains_sorted(batch, results);
+                    else trie->contains_batch(batch, results);
+                    for (size_t j = 0; j < count; j++) found += results[j];
+                }
+            }
+
+            auto end = std::chrono::steady_clock::now();
+            double ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+            std::cout << "BENCH batch"
+                      << " variant=" << variant
+                      << " lookup=" << (sorted ? "sorted" : "interleaved")
+                      << " batch_size=" << batch_size
+                      << " found=" << found
+                      << " ns_per_contains=" << ns / views.size()
+                      << " million_contains_per_s=" << views.size() / ns * 1000 << std::endl;
+        }
+    }
+}
+
+// This benchmark runs mixes of contains/insert/delete_elem on one ConcurrentTrie with 1, 2, 4, ... up to
+// max_threads threads. Half of the keys are inserted before, and every thread picks random keys. The
+// total number of operations stays the same for every thread count.
+static void bench_concurrent(const std::vector<std::string>& keys, size_t max_threads) {
+    struct Mix {
+        const char* name;
+        unsigned contains_percent;
+        unsigned insert_percent;
+    };
+    const Mix mixes[] = {{"c100", 100, 0}, {"c90_i5_d5", 90, 5}, {"c50_i25_d25", 50, 25}};
+    const size_t total_operations = 4000000;
+
+    for (const Mix& mix : mixes)
+    {
+        for (size_t nbr_threads = 1; nbr_threads <= max_threads; nbr_threads = nbr_threads * 2)
+        {
+            ConcurrentTrie trie;
+            for (size_t i = 0; i < keys.size(); i += 2) trie.insert(keys[i]);
+
+            std::vector<std::thread> threads;
+            auto start = std::chrono::steady_clock::now();
+
+            for (size_t t = 0; t < nbr_threads; t++)
+            {
+                threads.emplace_back([&, t]() {
+                    std::mt19937_64 random(t + 1);
+                    size_t operations = total_operations / nbr_threads;
+                    for (size_t i = 0; i < operations; i++)
+                    {
+                        uint64_t r = random();
+                        const std::string& key = keys[r % keys.size()];
+                        unsigned percent = (r >> 32) % 100;
+                        if (percent < mix.contains_percent) trie.contains(key);
+                        else if (percent < mix.contains_percent + mix.insert_percent) trie.insert(key);
+                        else trie.delete_elem(key);
+                    }
+                });
+            }
+            for (std::thread& thread : threads) thread.join();
+
+            auto end = std::chrono::steady_clock::now();
+            double ns = std::chrono::duration<double, std::nano>(end - start).count();
+            size_t operations = total_operations / nbr_threads * nbr_threads;
+
+            std::cout << "BENCH concurrent"
+                      << " mix=" << mix.name
+                      << " threads=" << nbr_threads
+                      << " hardware_threads=" << std::thread::hardware_concurrency()
+                      << " million_ops_per_s=" << operations / ns * 1000 << std::endl;
+        }
+    }
+}
+
+// This function looks up every word once and returns the average time per contains in nanoseconds. With T = Trie
+// every contains is a virtual call, with the final class of a variant it can be inlined.
+template<class T>
+static double time_contains(const T& trie, const std::vector<std::string_view>& words, size_t& found) {
+    found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (std::string_view word : words) found += trie.contains(word);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / words.size();
+}
+
+// This function inserts every key once and returns the average time per insert in nanoseconds, like
+// time_contains.
+template<class T>
+static double time_insert(T& trie, const std::vector<std::string>& keys) {
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string& key : keys) trie.insert(key);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / keys.size();
+}
+
+// This function builds the variant T twice from the keys, once through the Trie interface and once through its
+// own class, and then looks up all words in both ways.
+template<class T>
+static void bench_dispatch_variant(const std::string& variant, const std::vector<std::string>& keys, const std::vector<std::string_view>& words) {
+    std::unique_ptr<Trie> virtual_trie = std::make_unique<T>();
+    T direct_trie;
+    double ns_insert_virtual = time_insert(*virtual_trie, keys);
+    double ns_insert_direct = time_insert(direct_trie, keys);
+
+    size_t found_virtual;
+    size_t found_direct;
+    double ns_contains_virtual = time_contains(*virtual_trie, words, found_virtual);
+    double ns_contains_direct = time_contains(direct_trie, words, found_direct);
+
+    std::cout << "BENCH dispatch"
+              << " variant=" << variant
+              << " ns_per_insert_virtual=" << ns_insert_virtual
+              << " ns_per_insert_direct=" << ns_insert_direct
+              << " ns_per_contains_virtual=" << ns_contains_virtual
+              << " ns_per_contains_direct=" << ns_contains_direct
+              << " same_results=" << (found_virtual == found_direct) << std::endl;
+}
+
+// This benchmark compares the calls through the virtual Trie interface with calls through the class of the variant
+// (see RadixTrie.hpp and with_trie_class in main.cpp), for every key (a hit) and every key with its last letter
+// changed (mostly misses), in random order.
+static void bench_dispatch(const std::vector<std::string>& keys) {
+    std::vector<std::string> misses = keys;
+    for (std::string& key : misses)
+    {
+        if (!key.empty()) key.back() = key.back() == 'a' ? 'b' : 'a';
+    }
+    std::vector<std::string_view> words(keys.begin(), keys.end());
+    words.insert(words.end(), misses.begin(), misses.end());
+    std::shuffle(words.begin(), words.end(), std::mt19937(42));
+
+    bench_dispatch_variant<FixedSizeArrayTrie>("fixed_size_array_trie", keys, words);
+    bench_dispatch_variant<VariableSizeArrayTrie>("variable_size_array_trie", keys, words);
+    bench_dispatch_variant<HashTableTrie>("hash_table_trie", keys, words);
+}
+
+// This benchmark builds every variant from the input file, freezes it and frees the original. It reports the
+// resident memory of both (and the exact size of the frozen trie), and the time per contains of both, for
+// every key (a hit) and every key with its last letter changed (mostly misses), in random order.
+static void bench_freeze(const std::vector<std::string>& keys) {
+    std::vector<std::string> words = keys;
+    for (const std::string& key : keys)
+    {
+        std::string miss = key;
+        if (!miss.empty()) miss.back() = miss.back() == 'a' ? 'b' : 'a';
+        words.push_back(miss);
+    }
+    std::shuffle(words.begin(), words.end(), std::mt19937(42));
+    std::vector<std::string_view> views(words.begin(), words.end());
+
+    for (auto& [variant, trie] : make_tries())
+    {
+        malloc_trim(0);
+        size_t rss_before = current_rss_bytes();
+        for (const std::string& key : keys) trie->insert(key);
+        size_t rss_trie = current_rss_bytes() - rss_before;
+
+        size_t found_trie;
+        double ns_trie = time_contains(*trie, views, found_trie);
+
+        std::unique_ptr<FrozenTrie> frozen = trie->freeze();
+        trie.reset();
+        malloc_trim(0);
+        size_t rss_frozen = current_rss_bytes() - rss_before;
+
+        size_t found_frozen;
+        double ns_frozen = time_contains(*frozen, views, found_frozen);
+
+        std::cout << "BENCH freeze"
+                  << " variant=" << variant
+                  << " nodes=" << frozen->nbr_nodes()
+                  << " rss_trie_bytes=" << rss_trie
+                  << " rss_frozen_bytes=" << rss_frozen
+                  << " frozen_bytes=" << frozen->memory_bytes()
+                  << " rss_reduction=" << (double) rss_trie / std::max<size_t>(rss_frozen, 1)
+                  << " ns_per_contains_trie=" << ns_trie
+                  << " ns_per_contains_frozen=" << ns_frozen
+                  << " same_results=" << (found_trie == found_frozen) << std::endl;
+    }
+}
+
+// This benchmark builds every variant from the input file and reports the resident memory it needs per key.
+static void bench_memory(const std::vector<std::string>& keys) {
+    for (auto& [variant, trie] : make_tries())
+    {
+        malloc_trim(0);
+        size_t rss_before = current_rss_bytes();
+        size_t inserted = 0;
+        for (const std::string& key : keys) inserted += trie->insert(key);
+        size_t rss_trie = current_rss_bytes() - rss_before;
+
+        std::cout << "BENCH memory"
+                  << " variant=" << variant
+                  << " keys=" << inserted
+                  << " rss_trie_bytes=" << rss_trie
+                  << " bytes_per_key=" << (double) rss_trie / std::max<size_t>(inserted, 1) << std::endl;
+
+        trie.reset();
+    }
+}
+
+// This benchmark builds every variant from the input file, then inserts every key with its last letter changed
+// and deletes these words again. A changed word, that is a prefix of a key, is left out, since deleting it would
+// delete the key as well. Afterwards the trie should be the same as before: it reports the number of nodes, the
+// bytes of its labels (see Trie::stats) and the time per contains (for all keys in random order) before and after.
+static void bench_churn(const std::vector<std::string>& keys) {
+    std::vector<std::string_view> views(keys.begin(), keys.end());
+    std::shuffle(views.begin(), views.end(), std::mt19937(42));
+
+    for (auto& [variant, trie] : make_tries())
+    {
+        for (const std::string& key : keys) trie->insert(key);
+        size_t nodes_before = trie->freeze()->nbr_nodes();
+        size_t label_bytes_before = trie->stats().label_bytes;
+        size_t found_before;
+        double ns_before = time_contains(*trie, views, found_before);
+
+        std::vector<std::string> inserted;
+        for (const std::string& key : keys)
+        {
+            std::string word = key;
+            if (!word.empty()) word.back() = word.back() == 'a' ? 'b' : 'a';
+            if (!trie->contains(word) && trie->insert(word)) inserted.push_back(word);
+        }
+        for (const std::string& word : inserted) trie->delete_elem(word);
+
+        size_t nodes_after = trie->freeze()->nbr_nodes();
+        size_t label_bytes_after = trie->stats().label_bytes;
+        size_t found_after;
+        double ns_after = time_contains(*trie, views, found_after);
+
+        std::cout << "BENCH churn"
+                  << " variant=" << variant
+                  << " churned_words=" << inserted.size()
+                  << " nodes_before=" << nodes_before
+                  << " nodes_after=" << nodes_after
+                  << " label_bytes_before=" << label_bytes_before
+                  << " label_bytes_after=" << label_bytes_after
+                  << " ns_per_contains_before=" << ns_before
+                  << " ns_per_contains_after=" << ns_after
+                  << " same_results=" << (found_before == found_after) << std::endl;
+    }
+}
+
+// This function opens a hardware counter for the cache misses of this thread, or returns -1 if the kernel or
+// the (virtual) machine does not offer one.
+static int open_cache_miss_counter() {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// This benchmark compares the trie with one node per letter to the burst trie, which keeps the suffixes in
+// buckets of contiguous memory. Both are built from the input file, then every key (a hit) and every key with
+// its last letter changed (mostly misses) is looked up in random order. It reports the time and the cache
+// misses per lookup, or cache_misses_per_lookup=unavailable if there is no hardware counter.
+static void bench_cachemisses(const std::vector<std::string>& keys) {
+    std::vector<std::string> misses = keys;
+    for (std::string& key : misses)
+    {
+        if (!key.empty()) key.back() = key.back() == 'a' ? 'b' : 'a';
+    }
+    std::vector<std::string_view> words(keys.begin(), keys.end());
+    words.insert(words.end(), misses.begin(), misses.end());
+    std::shuffle(words.begin(), words.end(), std::mt19937(42));
+
+    std::vector<std::pair<std::string, std::unique_ptr<Trie>>> tries;
+    tries.emplace_back("variable_size_array_trie", std::make_unique<VariableSizeArrayTrie>());
+    tries.emplace_back("burst_trie", std::make_unique<BurstTrie>());
+
+    for (auto& [variant, trie] : tries)
+    {
+        malloc_trim(0);
+        size_t rss_before = current_rss_bytes();
+        for (const std::string& key : keys) trie->insert(key);
+        size_t rss_trie = current_rss_bytes() - rss_before;
+
+        int counter = open_cache_miss_counter();
+        if (counter >= 0)
+        {
+            ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+            ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        size_t found;
+        double ns_per_lookup = time_contains(*trie, words, found);
+        uint64_t cache_misses = 0;
+        if (counter >= 0)
+        {
+            ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(counter, &cache_misses, sizeof(cache_misses)) != sizeof(cache_misses)) cache_misses = 0;
+            close(counter);
+        }
+
+        std::cout << "BENCH cachemisses"
+                  << " variant=" << variant
+                  << " lookups=" << words.size()
+                  << " found=" << found
+                  << " rss_trie_bytes=" << rss_trie
+                  << " ns_per_lookup=" << ns_per_lookup
+                  << " cache_misses_per_lookup=";
+        if (counter >= 0) std::cout << (double) cache_misses / words.size() << std::endl;
+        else std::cout << "unavailable" << std::endl;
+
+        trie.reset();
+    }
+}
+
+// This function asks the kernel to drop the file from the page cache, so that the next read has to come from
+// the disk again, like after a restart of the machine.
+static void evict_from_page_cache(const std::string& file_name) {
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+// This benchmark measures the time from the start until the first querry can be answered. Every variant is
+// built from the text file like ti_programm does, and the frozen trie is written as an image and opened
+// again, with and without the checksum over the whole file. Before every run the file is dropped from the
+// page cache.
+static void bench_coldstart(const char* input_file_name) {
+    std::string first_key;
+    std::string image_file_name = (std::filesystem::temp_directory_path() / "ti_microbench_coldstart.image").string();
+    std::unique_ptr<FrozenTrie> frozen;
+
+    for (auto& [variant, trie] : make_tries())
+    {
+        evict_from_page_cache(input_file_name);
+        auto start = std::chrono::steady_clock::now();
+
+        InputFile input(input_file_name);
+        std::string_view line;
+        bool first = true;
+        while (input.next_line(line))
+        {
+            if (first) first_key = std::string(line);
+            first = false;
+            trie->insert(line);
+        }
+        bool found = trie->contains(first_key);
+
+        auto end = std::chrono::steady_clock::now();
+        std::cout << "BENCH coldstart"
+                  << " source=text variant=" << variant
+                  << " found=" << found
+                  << " ms_to_first_query=" << std::chrono::duration<double, std::milli>(end - start).count() << std::endl;
+
+        if (frozen == nullptr) frozen = trie->freeze();
+    }
+
+    frozen->save(image_file_name);
+    for (bool verify_checksum : {true, false})
+    {
+        evict_from_page_cache(image_file_name);
+        auto start = std::chrono::steady_clock::now();
+
+        FrozenTrie loaded(image_file_name, verify_checksum);
+        bool found = loaded.contains(first_key);
+
+        auto end = std::chrono::steady_clock::now();
+        std::cout << "BENCH coldstart"
+                  << " source=image verify_checksum=" << verify_checksum
+                  << " image_bytes=" << loaded.memory_bytes()
+                  << " found=" << found
+                  << " ms_to_first_query=" << std::chrono::duration<double, std::milli>(end - start).count() << std::endl;
+    }
+    std::filesystem::remove(image_file_name);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || (std::string(argv[1]) != "lcp" && argc < 3))
+    {
+        std::cerr << "Usage: " << argv[0] << " allocations <input_file> | lcp | batch <input_file> | concurrent <input_file> [max_threads] | freeze <input_file> | coldstart <input_file> | memory <input_file> | churn <input_file> | cachemisses <input_file> | dispatch <input_file>" << std::endl;
+        return 1;
+    }
+
+    std::string benchmark = argv[1];
+    if (benchmark == "allocations") bench_allocations(read_lines(argv[2]));
+    else if (benchmark == "lcp") bench_lcp();
+    else if (benchmark == "batch") bench_batch(read_lines(argv[2]));
+    else if (benchmark == "freeze") bench_freeze(read_lines(argv[2]));
+    else if (benchmark == "coldstart") bench_coldstart(argv[2]);
+    else if (benchmark == "memory") bench_memory(read_lines(argv[2]));
+    else if (benchmark == "churn") bench_churn(read_lines(argv[2]));
+    else if (benchmark == "cachemisses") bench_cachemisses(read_lines(argv[2]));
+    else if (benchmark == "dispatch") bench_dispatch(read_lines(argv[2]));
+    else if (benchmark == "concurrent") bench_concurrent(read_lines(argv[2]), argc > 3 ? std::stoul(argv[3]) : 64);
+    else
+    {
+        std::cerr << "Unknown benchmark: " << benchmark << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
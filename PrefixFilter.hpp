@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// A quotient filter of all prefixes of the words in a trie. contains asks it first and does not walk the trie at
+// all, if the filter knows that the word is not in there (see RadixTrie.hpp).
+//
+// contains is true for every prefix of a word, so the filter has to hold all of them and not only the words: one
+// entry for every letter of every edge label. The hash of a prefix is built letter by letter (FNV-1a), so one
+// pass over a word, or over the labels below a node, gives the hashes of all of its prefixes.
+//
+// The high bits of a hash (the quotient) select its home slot, and only the lowest 8 bits (the remainder) are
+// stored. The slots are kept like in EdgeTable.hpp, with linear probing and Robin Hood hashing: all entries with
+// the same home slot lie next to each other, and the distance to its home slot in every slot tells where an
+// entry belongs. So a check reads (nearly always) one cache line, and a word that is not in the trie only gets
+// through, if a prefix with the same home slot has the same remainder. Two prefixes with the same quotient and
+// remainder are two entries, so an entry can be removed again when delete_elem removes its prefix.
+class PrefixFilter {
+    private:
+        struct Slot {
+            uint8_t remainder;
+            uint8_t distance;       // 1 + how far the slot is from the home slot of its entry, 0 for an empty slot
+        };
+
+        static const size_t MAX_DISTANCE = 254;
+        static const size_t MIN_HOMES = 1024;
+        static const size_t PREFETCH_DISTANCE = 16;
+
+        // There are MAX_DISTANCE slots behind the last home slot, so that a probe never has to wrap around.
+        std::vector<Slot> slots;
+        size_t nbr_homes = 0;
+        size_t nbr_prefixes = 0;
+        bool overflowed = false;    // if an entry got further than MAX_DISTANCE from its home and is missing
+
+        // The counters of the checks for the FILTER line. contains is const, but it counts them anyway.
+        mutable size_t nbr_checks = 0;
+        mutable size_t nbr_rejects = 0;
+        mutable size_t nbr_false_positives = 0;
+
+        // The last letter of FNV-1a hardly changes the high bits of the hash, so the hash is mixed once more (the
+        // finalizer of MurmurHash3) before it is split into quotient and remainder.
+        static uint64_t mix(uint64_t hash) {
+            hash = (hash ^ (hash >> 33)) * 0xFF51AFD7ED558CCDull;
+            hash = (hash ^ (hash >> 33)) * 0xC4CEB9FE1A85EC53ull;
+            return hash ^ (hash >> 33);
+        }
+
+        size_t home_of(uint64_t mixed) const {
+            return (size_t) (((unsigned __int128) mixed * nbr_homes) >> 64);
+        }
+
+        // This function returns the slot of an entry with the home and remainder of mixed, or the number of slots
+        // if there is none.
+        size_t position_of(uint64_t mixed) const {
+            uint8_t remainder = (uint8_t) mixed;
+            size_t position = home_of(mixed);
+            for (size_t distance = 1; ; distance++)
+            {
+                const Slot& slot = slots[position];
+                if (slot.distance < distance) return slots.size();
+                if (slot.distance == distance && slot.remainder == remainder) return position;
+                position++;
+            }
+        }
+
+        // This function puts the entry of mixed into the table.
+        void place(uint64_t mixed) {
+            Slot entry{(uint8_t) mixed, 1};
+            size_t position = home_of(mixed);
+            while (true)
+            {
+                Slot& slot = slots[position];
+                if (slot.distance == 0)
+                {
+                    slot = entry;
+                    nbr_prefixes++;
+                    return;
+                }
+                if (slot.distance < entry.distance) std::swap(slot, entry);
+
+                position++;
+                entry.distance++;
+                if (entry.distance > MAX_DISTANCE)
+                {
+                    // The entry is dropped, so the filter has to be built again with more slots before the next
+                    // check (see needs_rebuild). This does not happen with a good hash.
+                    overflowed = true;
+                    return;
+                }
+            }
+        }
+
+        static double rate(size_t count, size_t total) {
+            return total == 0 ? 0 : (double) count / total;
+        }
+
+    public:
+        static const uint64_t EMPTY_HASH = 0xCBF29CE484222325ull;
+
+        // This function returns the hash of the prefix that is one letter longer than the one of hash.
+        static uint64_t extend(uint64_t hash, char letter) {
+            return (hash ^ (uint8_t) letter) * 0x100000001B3ull;
+        }
+
+        static uint64_t hash_of(std::string_view prefix) {
+            uint64_t hash = EMPTY_HASH;
+            for (char letter : prefix) hash = extend(hash, letter);
+            return hash;
+        }
+
+        // This function empties the filter and sizes it for a trie with the given number of prefixes: the table
+        // is 2/3 full then. The counters of the checks stay.
+        void reset(size_t expected_prefixes) {
+            nbr_homes = expected_prefixes + expected_prefixes / 2;
+            if (nbr_homes < MIN_HOMES) nbr_homes = MIN_HOMES;
+            slots.assign(nbr_homes + MAX_DISTANCE, Slot{0, 0});
+            nbr_prefixes = 0;
+            overflowed = false;
+        }
+
+        void add(uint64_t hash) { place(mix(hash)); }
+
+        // This function adds all hashes, that for_each_hash(f) calls f with, like the ones of a whole trie. Every
+        // home slot is a cache miss here, so it is only prefetched at first, and the entry is placed
+        // PREFETCH_DISTANCE hashes later.
+        template<class ForEachHash>
+        void add_all(ForEachHash for_each_hash) {
+            uint64_t pending[PREFETCH_DISTANCE];
+            size_t count = 0;
+            for_each_hash([&](uint64_t hash) {
+                uint64_t mixed = mix(hash);
+                __builtin_prefetch(&slots[home_of(mixed)], 1);
+                if (count >= PREFETCH_DISTANCE) place(pending[count % PREFETCH_DISTANCE]);
+                pending[count % PREFETCH_DISTANCE] = mixed;
+                count++;
+            });
+            for (size_t i = count > PREFETCH_DISTANCE ? count - PREFETCH_DISTANCE : 0; i < count; i++) place(pending[i % PREFETCH_DISTANCE]);
+        }
+
+        // This function adds the prefixes of word, that are longer than its first nbr_known letters.
+        void add_word(std::string_view word, size_t nbr_known) {
+            uint64_t hash = hash_of(word.substr(0, nbr_known));
+            for (size_t i = nbr_known; i < word.length(); i++)
+            {
+                hash = extend(hash, word[i]);
+                add(hash);
+            }
+        }
+
+        // This function removes one entry of the hash. The entries behind it, that are not in their home slot,
+        // are moved one slot back, so that no check stops too early.
+        void remove(uint64_t hash) {
+            size_t position = position_of(mix(hash));
+            if (position == slots.size()) return;
+
+            while (position + 1 < slots.size() && slots[position + 1].distance > 1)
+            {
+                slots[position] = Slot{slots[position + 1].remainder, (uint8_t) (slots[position + 1].distance - 1)};
+                position++;
+            }
+            slots[position] = Slot{0, 0};
+            nbr_prefixes--;
+        }
+
+        // The filter has to be built again, if an entry is missing, if it is more than 7/8 full, or if it is less
+        // than 1/8 full and could be much smaller.
+        bool needs_rebuild() const {
+            return overflowed || nbr_prefixes * 8 > nbr_homes * 7 || (nbr_homes > MIN_HOMES && nbr_prefixes * 8 < nbr_homes);
+        }
+
+        bool has_overflowed() const { return overflowed; }
+
+        // This function is the check of contains: it returns false if word is no prefix in the trie for sure,
+        // and true if the trie has to be walked.
+        bool check(std::string_view word) const { return check_mixed(mix(hash_of(word))); }
+
+        // A batch of checks is faster in two steps: prefetch_check returns the mixed hash of a word and prefetches
+        // its home slot, and check_mixed does the check of contains with it, when the slot is (hopefully) in the
+        // cache.
+        uint64_t prefetch_check(std::string_view word) const {
+            uint64_t mixed = mix(hash_of(word));
+            __builtin_prefetch(&slots[home_of(mixed)]);
+            return mixed;
+        }
+
+        bool check_mixed(uint64_t mixed) const {
+            nbr_checks++;
+            if (position_of(mixed) != slots.size()) return 1;
+            nbr_rejects++;
+            return 0;
+        }
+
+        // contains calls this function if the trie did not have a word, that the check let through.
+        void count_false_positive() const { nbr_false_positives++; }
+
+        size_t memory_bytes() const { return slots.size() * sizeof(Slot); }
+
+        // This function prints the size of the filter and how well it worked as a FILTER line. The hit rate is
+        // the share of the checked words, that the filter answered alone, the false positive rate the share of
+        // the checked words that are not in the trie, that it still let through.
+        void print(std::ostream& out) const {
+            out << "FILTER prefixes=" << nbr_prefixes
+                << " bytes=" << memory_bytes()
+                << " checks=" << nbr_checks
+                << " rejects=" << nbr_rejects
+                << " false_positives=" << nbr_false_positives
+                << " hit_rate=" << rate(nbr_rejects, nbr_checks)
+                << " false_positive_rate=" << rate(nbr_false_positives, nbr_false_positives + nbr_rejects) << std::endl;
+        }
+};
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "Tries.hpp"
+#include "InputFile.hpp"
+#include "SpscRing.hpp"
+#include "LatencyHistogram.hpp"
+
+// A batch of querries on its way through the pipeline. The batches are allocated once and then passed
+// around in a circle: reader -> executor -> writer -> reader.
+struct QueryBatch {
+    static const size_t CAPACITY = 4096;
+
+    std::vector<std::string_view> words;
+    std::vector<char> querry_types;
+    std::vector<bool> results;
+
+    // If the querry file is not memory mapped, its lines are only valid until the next line is read. Then
+    // the words are copied into storage first and the views point into it.
+    std::string storage;
+    std::vector<size_t> word_ends;
+
+    // The reader sets last on the final batch. If it stopped because of an unsupported querry type,
+    // invalid is set and that type is stored in error.
+    bool last = false;
+    bool invalid = false;
+    std::string error;
+
+    void clear() {
+        words.clear();
+        querry_types.clear();
+        results.clear();
+        storage.clear();
+        word_ends.clear();
+        last = false;
+        invalid = false;
+        error.clear();
+    }
+};
+
+// This class runs the querries of a querry file against a trie in three stages, that work at the same
+// time on different batches:
+//
+//   1. the reader thread splits the lines into words and querry types,
+//   2. the executor (the thread calling run) calls contains_batch for every run of contains querries (or
+//      contains_sorted, if the runs are to be sorted) and delete_elem or insert for every other querry (with
+//      a LatencyRecorder, the sampled querries are run on their own and timed, see LatencyHistogram.hpp),
+//   3. the writer thread turns the results into "true"/"false" lines and writes them in large blocks.
+//
+// The stages are connected by single producer single consumer rings, so only the executor touches the
+// trie, and the querries are executed and written in the order of the file.
+class QueryPipeline {
+    private:
+        static const size_t NBR_BATCHES = 8;
+        static const size_t WRITE_SIZE = 1 << 20;
+
+        InputFile& querry;
+        std::ostream& output;
+        bool debug_output;
+        bool sorted_runs;       // if the runs of contains querries are looked up in sorted order
+        LatencyRecorder* latency;
+
+        std::vector<QueryBatch> batches;
+        SpscRing<QueryBatch*, NBR_BATCHES> free_batches;
+        SpscRing<QueryBatch*, NBR_BATCHES> parsed_batches;
+        SpscRing<QueryBatch*, NBR_BATCHES> executed_batches;
+
+        // Set by the executor when it stops early, so that the reader does not wait for free batches forever.
+        std::atomic<bool> stopped{false};
+
+        void read_querries() {
+            std::string_view line;
+            std::string_view word;
+            std::string_view querry_type;
+
+            while (true)
+            {
+                QueryBatch* batch;
+                while (!free_batches.try_pop(batch))
+                {
+                    if (stopped.load()) return;
+                    std::this_thread::yield();
+                }
+                batch->clear();
+
+                while (batch->querry_types.size() < QueryBatch::CAPACITY)
+                {
+                    if (!querry.next_line(line))
+                    {
+                        batch->last = true;
+                        break;
+                    }
+
+                    split_querry(line, word, querry_type);
+                    if (querry_type.length() != 1 || (querry_type[0] != 'c' && querry_type[0] != 'd' && querry_type[0] != 'i'))
+                    {
+                        batch->error = std::string(querry_type);
+                        batch->invalid = true;
+                        batch->last = true;
+                        break;
+                    }
+
+                    if (querry.is_mapped())
+                    {
+                        batch->words.push_back(word);
+                    }
+                    else
+                    {
+                        batch->storage.append(word);
+                        batch->word_ends.push_back(batch->storage.length());
+                    }
+                    batch->querry_types.push_back(querry_type[0]);
+                }
+
+                // Now that storage does not grow anymore, the views into it can be made.
+                size_t word_begin = 0;
+                for (size_t word_end : batch->word_ends)
+                {
+                    batch->words.push_back(std::string_view(batch->storage).substr(word_begin, word_end - word_begin));
+                    word_begin = word_end;
+                }
+
+                parsed_batches.push(batch);
+                if (batch->last) return;
+            }
+        }
+
+        void write_results() {
+            std::string buffer;
+            buffer.reserve(WRITE_SIZE + 16);
+
+            while (true)
+            {
+                QueryBatch* batch = executed_batches.pop();
+
+                for (bool result : batch->results)
+                {
+                    if (result) buffer.append("true\n");
+                    else buffer.append("false\n");
+
+                    if (buffer.length() >= WRITE_SIZE)
+                    {
+                        output.write(buffer.data(), buffer.length());
+                        buffer.clear();
+                    }
+                }
+
+                if (batch->last)
+                {
+                    output.write(buffer.data(), buffer.length());
+                    output.flush();
+                    return;
+                }
+                free_batches.push(batch);
+            }
+        }
+
+    public:
+        QueryPipeline(InputFile& querry, std::ostream& output, bool debug_output, LatencyRecorder* latency = nullptr, bool sorted_runs = false)
+            : querry(querry), output(output), debug_output(debug_output), sorted_runs(sorted_runs), latency(latency), batches(NBR_BATCHES) {
+            for (QueryBatch& batch : batches)
+            {
+                batch.words.reserve(QueryBatch::CAPACITY);
+                batch.querry_types.reserve(QueryBatch::CAPACITY);
+                batch.results.reserve(QueryBatch::CAPACITY);
+                free_batches.push(&batch);
+            }
+        }
+
+        // This function runs all querries of the file. If the file contains an unsupported querry type, or a
+        // trie operation throws, all querries before it are executed and written, and then the exception is
+        // thrown here.
+        //
+        // T is the class of the trie. If it is a final class (and not only Trie), the querries are no virtual
+        // calls and can be inlined into the loop.
+        template<class T>
+        void run(T& trie) {
+            std::thread reader(&QueryPipeline::read_querries, this);
+            std::thread writer(&QueryPipeline::write_results, this);
+            std::exception_ptr exception;
+            std::vector<bool> run_results;
+
+            while (true)
+            {
+                QueryBatch* batch = parsed_batches.pop();
+
+                try
+                {
+                    size_t i = 0;
+                    bool timed = false;     // if querry i is already sampled to be timed
+                    while (i < batch->querry_types.size())
+                    {
+                        // A run of contains querries does not change the trie, so it is answered with one
+                        // interleaved contains_batch call (or one contains_sorted call). Every insert or delete
+                        // ends the run, so the querries still see the trie in the order of the file. The latency
+                        // of a single querry can not be told apart in there, so the run ends before the next
+                        // querry, that is sampled.
+                        size_t run_end = i;
+                        while (!timed && run_end < batch->querry_types.size() && batch->querry_types[run_end] == 'c')
+                        {
+                            if (latency != nullptr && latency->sample()) timed = true;
+                            else run_end++;
+                        }
+
+                        if (run_end > i)
+                        {
+                            std::span<const std::string_view> run(std::span<const std::string_view>(batch->words).subspan(i, run_end - i));
+                            if (sorted_runs) trie.contains_sorted(run, run_results);
+                            else trie.contains_batch(run, run_results);
+                            for (size_t j = i; j < run_end; j++)
+                            {
+                                bool result = run_results[j - i];
+                                if (debug_output) std::cout << "querry type: c for word: " << batch->words[j] << " - result: " << result << std::endl;
+                                batch->results.push_back(result);
+                            }
+                            i = run_end;
+                            continue;
+                        }
+
+                        std::string_view word = batch->words[i];
+                        char querry_type = batch->querry_types[i];
+                        auto execute = [&]() -> bool {
+                            if (querry_type == 'c')     return trie.contains(word);
+                            if (querry_type == 'd')     return trie.delete_elem(word);
+                            return trie.insert(word);
+                        };
+                        if (!timed && latency != nullptr && querry_type != 'c') timed = latency->sample();
+                        bool result = timed ? latency->measure(querry_type, execute) : execute();
+                        timed = false;
+
+                        if (debug_output) std::cout << "querry type: " << querry_type << " for word: " << word << " - result: " << result << std::endl;
+
+                        batch->results.push_back(result);
+                        i++;
+                    }
+
+                    if (batch->invalid) throw std::invalid_argument("Unsupported querry type: " + batch->error);
+                }
+                catch (...)
+                {
+                    exception = std::current_exception();
+                    batch->last = true;
+                }
+
+                bool last = batch->last;
+                executed_batches.push(batch);
+                if (last) break;
+            }
+
+            stopped.store(true);
+            reader.join();
+            writer.join();
+
+            if (exception) std::rethrow_exception(exception);
+        }
+};
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Sorting the words of the input file for Trie::bulk_load. The words are sorted like std::string_view
+// compares them (byte by byte, as unsigned chars), with a most significant digit first radix sort: the words
+// are distributed into buckets by their letter at some depth, and every bucket is sorted by the next letter.
+// Words that end before that depth get their own bucket in front of all others.
+namespace radix_sort {
+    static const size_t NBR_BUCKETS = 257;
+    static const size_t SMALL_SORT_LIMIT = 32;
+    static const size_t PARALLEL_LIMIT = 1 << 16;
+    static const size_t MAX_RADIX_DEPTH = 256;
+
+    inline size_t bucket_at(std::string_view word, size_t depth) {
+        return depth < word.length() ? (unsigned char) word[depth] + 1 : 0;
+    }
+
+    // All words share their first depth letters, so only the rest has to be compared. The items are the words
+    // themselves or something, that word_of turns into a word (like their positions in an array of words).
+    template<class T, class WordOf>
+    void insertion_sort(T* items, size_t n, size_t depth, WordOf word_of) {
+        for (size_t i = 1; i < n; i++)
+        {
+            T item = items[i];
+            std::string_view word = word_of(item);
+            size_t j = i;
+            while (j > 0 && word_of(items[j - 1]).substr(depth) > word.substr(depth))
+            {
+                items[j] = items[j - 1];
+                j--;
+            }
+            items[j] = item;
+        }
+    }
+
+    // This function sorts n items by their words, that share their first depth letters. buffer needs room for n
+    // items. Every level of the recursion needs two count arrays on the stack, so very long common prefixes are
+    // sorted by comparisons instead.
+    template<class T, class WordOf>
+    void sort_range(T* items, T* buffer, size_t n, size_t depth, WordOf word_of) {
+        if (n < SMALL_SORT_LIMIT)
+        {
+            insertion_sort(items, n, depth, word_of);
+            return;
+        }
+        if (depth >= MAX_RADIX_DEPTH)
+        {
+            std::sort(items, items + n, [&](const T& a, const T& b) { return word_of(a) < word_of(b); });
+            return;
+        }
+
+        size_t bucket_start[NBR_BUCKETS + 1] = {};
+        for (size_t i = 0; i < n; i++) bucket_start[bucket_at(word_of(items[i]), depth) + 1]++;
+        for (size_t b = 0; b < NBR_BUCKETS; b++) bucket_start[b + 1] += bucket_start[b];
+
+        size_t position[NBR_BUCKETS];
+        std::copy(bucket_start, bucket_start + NBR_BUCKETS, position);
+        for (size_t i = 0; i < n; i++) buffer[position[bucket_at(word_of(items[i]), depth)]++] = items[i];
+        std::copy(buffer, buffer + n, items);
+
+        // The words in bucket 0 all end at depth, so they are equal already.
+        for (size_t b = 1; b < NBR_BUCKETS; b++)
+        {
+            size_t size = bucket_start[b + 1] - bucket_start[b];
+            if (size > 1) sort_range(items + bucket_start[b], buffer + bucket_start[b], size, depth + 1, word_of);
+        }
+    }
+
+    inline void sort_range(std::string_view* words, std::string_view* buffer, size_t n, size_t depth) {
+        sort_range(words, buffer, n, depth, [](std::string_view word) { return word; });
+    }
+
+    // This function moves the items into out, grouped by their bucket (a number below NBR_BUCKETS), and returns
+    // where every bucket starts (bucket_start[NBR_BUCKETS] is the number of items). Items in the same bucket
+    // keep their order. Every thread counts the buckets of its part of the items and then moves them to their
+    // bucket, at positions that follow from the counts of all threads.
+    template<class T, class BucketOf>
+    std::vector<size_t> distribute(const std::vector<T>& items, std::vector<T>& out, size_t nbr_threads, BucketOf bucket_of) {
+        size_t n = items.size();
+        std::vector<std::vector<size_t>> counts(nbr_threads, std::vector<size_t>(NBR_BUCKETS, 0));
+        std::vector<std::thread> threads;
+
+        auto part_begin = [&](size_t t) { return n * t / nbr_threads; };
+
+        for (size_t t = 0; t < nbr_threads; t++)
+        {
+            threads.emplace_back([&, t]() {
+                for (size_t i = part_begin(t); i < part_begin(t + 1); i++) counts[t][bucket_of(items[i])]++;
+            });
+        }
+        for (std::thread& thread : threads) thread.join();
+        threads.clear();
+
+        // Bucket b starts behind all smaller buckets, and inside a bucket every thread gets the room for
+        // its items behind the threads before it.
+        std::vector<size_t> bucket_start(NBR_BUCKETS + 1, 0);
+        std::vector<std::vector<size_t>> positions(nbr_threads, std::vector<size_t>(NBR_BUCKETS));
+        size_t position = 0;
+        for (size_t b = 0; b < NBR_BUCKETS; b++)
+        {
+            bucket_start[b] = position;
+            for (size_t t = 0; t < nbr_threads; t++)
+            {
+                positions[t][b] = position;
+                position += counts[t][b];
+            }
+        }
+        bucket_start[NBR_BUCKETS] = n;
+
+        out.resize(n);
+        for (size_t t = 0; t < nbr_threads; t++)
+        {
+            threads.emplace_back([&, t]() {
+                for (size_t i = part_begin(t); i < part_begin(t + 1); i++) out[positions[t][bucket_of(items[i])]++] = items[i];
+            });
+        }
+        for (std::thread& thread : threads) thread.join();
+
+        return bucket_start;
+    }
+}
+
+// This function returns the positions of the words in the order of the sorted words (see sorted_contains in
+// BatchLookup.hpp). Equal words are next to each other, in no particular order.
+inline std::vector<uint32_t> sorted_positions(std::span<const std::string_view> words) {
+    std::vector<uint32_t> positions(words.size());
+    std::vector<uint32_t> buffer(words.size());
+    for (size_t i = 0; i < words.size(); i++) positions[i] = (uint32_t) i;
+    radix_sort::sort_range(positions.data(), buffer.data(), positions.size(), 0, [&](uint32_t i) { return words[i]; });
+    return positions;
+}
+
+// This function sorts the words and removes duplicates, so that they can be given to Trie::bulk_load.
+//
+// With more than one thread, the words are distributed by their first letter in parallel. Afterwards the
+// threads take the buckets one by one, the largest first, and sort them on their own.
+inline void sort_words(std::vector<std::string_view>& words, size_t nbr_threads = std::thread::hardware_concurrency()) {
+    using namespace radix_sort;
+
+    size_t n = words.size();
+    std::vector<std::string_view> buffer(n);
+
+    if (nbr_threads <= 1 || n < PARALLEL_LIMIT)
+    {
+        sort_range(words.data(), buffer.data(), n, 0);
+    }
+    else
+    {
+        std::vector<size_t> bucket_start = distribute(words, buffer, nbr_threads, [](std::string_view word) { return bucket_at(word, 0); });
+        words.swap(buffer);
+
+        std::vector<size_t> order;
+        for (size_t b = 1; b < NBR_BUCKETS; b++)
+        {
+            if (bucket_start[b + 1] - bucket_start[b] > 1) order.push_back(b);
+        }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return bucket_start[a + 1] - bucket_start[a] > bucket_start[b + 1] - bucket_start[b];
+        });
+
+        std::vector<std::thread> threads;
+        std::atomic<size_t> next_bucket{0};
+        for (size_t t = 0; t < nbr_threads; t++)
+        {
+            threads.emplace_back([&]() {
+                for (size_t i = next_bucket.fetch_add(1); i < order.size(); i = next_bucket.fetch_add(1))
+                {
+                    size_t b = order[i];
+                    sort_range(words.data() + bucket_start[b], buffer.data() + bucket_start[b], bucket_start[b + 1] - bucket_start[b], 1);
+                }
+            });
+        }
+        for (std::thread& thread : threads) thread.join();
+    }
+
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+}
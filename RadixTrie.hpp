@@ -0,0 +1,467 @@
+#pragma once
+
+#include <memory>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "Tries.hpp"
+#include "Arena.hpp"
+#include "EdgeLabel.hpp"
+#include "BatchLookup.hpp"
+#include "BulkLoad.hpp"
+#include "ShardedBuild.hpp"
+#include "FrozenTrie.hpp"
+#include "PrefixFilter.hpp"
+
+// A compressed trie whose nodes live in an arena. The walk through the trie (insert, contains and delete_elem,
+// the batch lookup, bulk load, parallel build, freeze and stats) is written only once, here. How a node stores
+// its children is left to the NodePolicy, so FixedSizeArrayTrie, VariableSizeArrayTrie and HashTableTrie are
+// this class with different policies (see FixedSize.cpp, VariableSizeTrie.cpp and HashTableTrie.cpp).
+//
+// The policy is a member of the trie, so a policy can keep state for all nodes (like the edge table of
+// HashTableTrie) or none at all. It has to provide:
+//
+//   struct Node                                        with the members EdgeLabel label and bool word_end, and
+//                                                      the constructors Node(EdgeLabel, bool, Arena&) and
+//                                                      Node(std::string_view, bool, Arena&)
+//   Node* find_child(Node*, char letter, const Arena&) the child whose label begins with letter, or nullptr
+//   void for_each_child(Node*, const Arena&, f)        calls f(Node*) for every child
+//   size_t nbr_children(Node*, const Arena&)
+//   void add_child(Node*, Node* child, Arena&)         the node has no child with the same first letter yet
+//   void delete_child(Node*, char letter, Arena&)
+//   void release(Node*, Arena&)                        gives the node, its label and all of its descendants back
+//   void learn(std::span<const std::string_view>)      sees all words before a build (see Alphabet.hpp)
+//   void learn(std::string_view text)                  sees the text of the input file before the inserts
+//   NodePolicy shard_policy()                          the policy for a shard of insert_parallel
+//   void take_over(NodePolicy& shard)                  takes what the policy of a shard of insert_parallel
+//                                                      keeps for its nodes, after they were moved over
+//   void account(Node*, size_t nbr_children, TrieStats&)   adds the node to the statistics
+//   void account_policy(TrieStats&)                    adds what the policy keeps outside of the nodes
+//
+// All of these are called on the concrete policy, so the compiler can inline them into the walk. The class is
+// final, so a caller that knows the concrete trie (like the querry loop of main.cpp) does not need the virtual
+// calls of the Trie interface either.
+//
+// With use_filter, contains asks a quotient filter of all prefixes in the trie first (see PrefixFilter.hpp).
+// insert adds the prefixes it makes new and delete_elem removes the ones it deletes, so the filter never rejects
+// a word that is in the trie, and a deleted word gets through no more often than any other.
+template<class NodePolicy>
+class RadixTrie final : public Trie {
+    private:
+        using Node = typename NodePolicy::Node;
+
+        Arena arena;
+        NodePolicy nodes;
+        Node* root;
+
+        // The tries that were built by the threads of insert_parallel. Their roots are empty, but their arenas
+        // still hold the nodes that were moved over into this trie.
+        std::vector<std::unique_ptr<RadixTrie>> shards;
+
+        std::unique_ptr<PrefixFilter> filter;
+
+        // This function restores the compressed form after a child of node was deleted. A node, that is neither
+        // the root nor the end of a word and has only one child left, is merged into that child: the child gets
+        // the joined label and takes the place of the node in parent_node. Every other node, that is no word end,
+        // still has two children at least, so it can not become a leave.
+        void merge_with_only_child(Node* parent_node, Node* node) {
+            if (node == root || node->word_end || nodes.nbr_children(node, arena) != 1) return;
+
+            Node* only_child = nullptr;
+            nodes.for_each_child(node, arena, [&](Node* child) { only_child = child; });
+
+            char letter = node->label.first();
+            nodes.delete_child(node, only_child->label.first(), arena);
+            only_child->label.prepend(node->label.view(arena), arena);
+            nodes.delete_child(parent_node, letter, arena);
+            nodes.release(node, arena);
+            nodes.add_child(parent_node, only_child, arena);
+        }
+
+        // This function splits node, a child of parent_node, behind the first length letters of its label. The
+        // new intermediate node gets these letters and takes the place of node in parent_node, node keeps the
+        // rest of its label and becomes the only child of the intermediate node, which is returned.
+        Node* split(Node* parent_node, Node* node, size_t length, bool word_end) {
+            char letter = node->label.first();
+            Node* intermediate_node = arena.create<Node>(node->label.prefix(length, arena), word_end, arena);
+
+            // The intermediate node takes the place of node in parent_node. This has to happen before the label
+            // of node changes, since the child is found by its first letter.
+            nodes.delete_child(parent_node, letter, arena);
+            nodes.add_child(parent_node, intermediate_node, arena);
+
+            node->label.remove_prefix(length, arena);
+            nodes.add_child(intermediate_node, node, arena);
+            return intermediate_node;
+        }
+
+        // This function calls f with the hash of every prefix, that ends in the label of node or below it. hash is
+        // the hash of the letters above the label.
+        template<class F>
+        void for_each_prefix(Node* node, uint64_t hash, F f) const {
+            for (char letter : node->label.view(arena))
+            {
+                hash = PrefixFilter::extend(hash, letter);
+                f(hash);
+            }
+            nodes.for_each_child(node, arena, [&](Node* child) { for_each_prefix(child, hash, f); });
+        }
+
+        // This function fills the filter with all prefixes of the trie, sized for their number.
+        void rebuild_filter() {
+            size_t nbr_prefixes = 0;
+            for_each_prefix(root, PrefixFilter::EMPTY_HASH, [&](uint64_t) { nbr_prefixes++; });
+            do
+            {
+                filter->reset(nbr_prefixes);
+                filter->add_all([&](auto f) { for_each_prefix(root, PrefixFilter::EMPTY_HASH, f); });
+                nbr_prefixes = nbr_prefixes * 2;
+            } while (filter->has_overflowed());
+        }
+
+        // insert calls this function for a new word, whose first nbr_known letters were a prefix in the trie
+        // before. All longer prefixes of it are new.
+        void filter_insert(std::string_view elem, size_t nbr_known) {
+            if (filter == nullptr) return;
+            filter->add_word(elem, nbr_known);
+            if (filter->needs_rebuild()) rebuild_filter();
+        }
+
+        // delete_elem calls this function before it releases node, whose label begins behind the given letters
+        // of elem. The prefixes that end in its label or below are the ones, that are gone from the trie
+        // afterwards. The prefixes above stay, since the parent of node is the root, a word end or has another
+        // child.
+        void filter_delete(Node* node, std::string_view elem, size_t nbr_letters_above) {
+            if (filter == nullptr) return;
+            uint64_t hash = PrefixFilter::hash_of(elem.substr(0, nbr_letters_above));
+            for_each_prefix(node, hash, [&](uint64_t prefix_hash) { filter->remove(prefix_hash); });
+        }
+
+        // This is contains without the filter, the walk through the trie.
+        bool walk_contains(std::string_view elem) const {
+            size_t matched_characters = 0;
+            Node* current_node = root;
+            Node* next_node;
+            char first_letter;
+
+            while (true)
+            {
+                first_letter = letter_at(elem, matched_characters);
+                next_node = nodes.find_child(current_node, first_letter, arena);
+
+                if (next_node == nullptr)
+                {
+                    // There is no edge with the first letter of our unmatched suffix. Therefore, the word is not
+                    // in the trie and we can return false.
+                    return 0;
+                }
+                else
+                {
+                    // We now step into the next node and compare the suffix of our word with the edge of that node.
+                    // The suffix is only a view into elem, so nothing gets copied here.
+                    current_node = next_node;
+
+                    size_t lcp = lcp_function(elem.substr(matched_characters), current_node->label.view(arena));
+                    size_t suffix_length = elem.length() - matched_characters;
+                    size_t edge_length = current_node->label.size();
+
+                    if (lcp == suffix_length)
+                    {
+                        // This means, we reached a leave and therefore the element is contained in the trie.
+                        return 1;
+                    }
+                    else if (lcp == edge_length)
+                    {
+                        // This means, we can not yet make a decicion weather or not the word is contained in the trie.
+                        matched_characters = matched_characters + lcp;
+                    }
+                    else {
+                        // This means, that lcp is smaller then both edge_length and suffix_length, so we now that
+                        // the word is not contained in the trie.
+                        return 0;
+                    }
+
+                }
+
+            }
+
+            return 0;
+        }
+
+        // This function answers contains for a batch of words with lookup(words, results), one of the batch
+        // lookups of BatchLookup.hpp. With the filter, the words it rejects are answered right away, and only
+        // the others are looked up. The home slots of all words are prefetched before the first check.
+        template<class Lookup>
+        void filtered_lookup(std::span<const std::string_view> elems, std::vector<bool>& results, Lookup lookup) const {
+            if (filter == nullptr)
+            {
+                lookup(elems, results);
+                return;
+            }
+
+            std::vector<uint64_t> hashes(elems.size());
+            for (size_t i = 0; i < elems.size(); i++) hashes[i] = filter->prefetch_check(elems[i]);
+
+            std::vector<std::string_view> passed;
+            std::vector<size_t> positions;
+            for (size_t i = 0; i < elems.size(); i++)
+            {
+                if (elems[i].empty() || filter->check_mixed(hashes[i]))
+                {
+                    passed.push_back(elems[i]);
+                    positions.push_back(i);
+                }
+            }
+
+            std::vector<bool> passed_results;
+            lookup(passed, passed_results);
+            results.assign(elems.size(), 0);
+            for (size_t i = 0; i < passed.size(); i++)
+            {
+                results[positions[i]] = passed_results[i];
+                if (!passed_results[i] && !passed[i].empty()) filter->count_false_positive();
+            }
+        }
+
+        // This constructor makes a shard for insert_parallel. Its arena takes its slabs from the range of the
+        // given arena, so that its nodes can be added to that trie by their indices.
+        RadixTrie(const Arena& range_owner, NodePolicy shard_nodes) : arena(Arena::SharedRange(), range_owner), nodes(std::move(shard_nodes)) {
+            root = arena.create<Node>("", 0, arena);
+        }
+
+    public:
+        // The nodes and their labels only live in the arena and need no destructor, so the arena gives their
+        // memory back in one go when the trie is destroyed.
+        RadixTrie(bool huge_pages = false) : arena(huge_pages) {
+            root = arena.create<Node>("", 0, arena);
+        }
+
+        bool insert(std::string_view elem) override {
+            size_t matched_characters = 0;
+            Node* current_node = root;
+            Node* parent_node;
+            Node* new_leave_node;
+            Node* next_node;
+            char first_letter;
+
+            while (true)
+            {
+                first_letter = letter_at(elem, matched_characters);
+                next_node = nodes.find_child(current_node, first_letter, arena);
+
+                if (next_node == nullptr)
+                {
+                    // There is no edge with the first letter of our unmatched suffix. Therefore, the word is not
+                    // in the trie and we can add it here.
+                    nodes.add_child(current_node, arena.create<Node>(elem.substr(matched_characters), 1, arena), arena);
+                    filter_insert(elem, matched_characters);
+                    return 1;
+                }
+                else
+                {
+                    // We now step into the next node and compare the suffix of our word with the edge of that node.
+                    // The suffix is only a view into elem, so nothing gets copied here.
+                    parent_node = current_node;
+                    current_node = next_node;
+
+                    size_t lcp = lcp_function(elem.substr(matched_characters), current_node->label.view(arena));
+                    size_t suffix_length = elem.length() - matched_characters;
+                    size_t edge_length = current_node->label.size();
+
+                    if (lcp == suffix_length)
+                    {
+                        // This means, the word ends in the label of this node, so all of its prefixes are in the
+                        // trie already. If it ends inside of the label, the node is split there, so that the end
+                        // of the word gets a node of its own. The word was only in the trie before, if that node
+                        // already was a word end. Otherwise a later delete_elem of a longer word would take it
+                        // away, and the result would depend on the order of the inserts.
+                        if (lcp < edge_length) current_node = split(parent_node, current_node, lcp, 0);
+
+                        bool was_word_end = current_node->word_end;
+                        current_node->word_end = 1;
+                        return !was_word_end;
+                    }
+                    else if (lcp == edge_length)
+                    {
+                        // This means, we can not yet make a decicion weather or not the word is in the trie.
+                        matched_characters = matched_characters + lcp;
+                    }
+                    else {
+                        // This means, that lcp is smaller then both edge_length and suffix_length, so we now that
+                        // the word is not in the trie and we can insert it here.
+                        //
+                        // For that, we now have to split the current_node at lcp and make two child nodes.
+                        // One of the two new nodes will be the a leave (no children) and on its edge we write the
+                        // unmatched suffix of our word. The other will have the unmatched suffix of the edge label
+                        // and its children are going to be the children of the current node.
+                        current_node = split(parent_node, current_node, lcp, 0);
+                        new_leave_node = arena.create<Node>(elem.substr(matched_characters + lcp), 1, arena);
+                        nodes.add_child(current_node, new_leave_node, arena);
+
+                        filter_insert(elem, matched_characters + lcp);
+                        return 1;
+                    }
+
+                }
+
+            }
+
+            return 0;
+        }
+
+        // The empty word is never checked, it is no prefix of the other words.
+        bool contains(std::string_view elem) const override {
+            if (filter == nullptr || elem.empty()) return walk_contains(elem);
+            if (!filter->check(elem)) return 0;
+
+            bool found = walk_contains(elem);
+            if (!found) filter->count_false_positive();
+            return found;
+        }
+
+        void contains_batch(std::span<const std::string_view> elems, std::vector<bool>& results) const override {
+            filtered_lookup(elems, results, [this](std::span<const std::string_view> words, std::vector<bool>& word_results) {
+                batch_contains(*this, root, words, word_results,
+                    [this](Node* node, char letter) { return nodes.find_child(node, letter, arena); },
+                    [this](Node* node) { return node->label.view(arena); });
+            });
+        }
+
+        void contains_sorted(std::span<const std::string_view> elems, std::vector<bool>& results) const override {
+            filtered_lookup(elems, results, [this](std::span<const std::string_view> words, std::vector<bool>& word_results) {
+                sorted_contains(*this, root, words, word_results,
+                    [this](Node* node, char letter) { return nodes.find_child(node, letter, arena); },
+                    [this](Node* node) { return node->label.view(arena); });
+            });
+        }
+
+        bool use_filter() override {
+            if (filter == nullptr) filter = std::make_unique<PrefixFilter>();
+            rebuild_filter();
+            return 1;
+        }
+
+        const PrefixFilter* prefix_filter() const override { return filter.get(); }
+
+        void learn_alphabet(std::string_view text) override {
+            nodes.learn(text);
+        }
+
+        void bulk_load(std::span<const std::string_view> elems) override {
+            nodes.learn(elems);
+            build_sorted<Node>(*this, elems,
+                [this](std::string_view label, std::span<Node* const> children, bool word_end) {
+                    Node* node = arena.create<Node>(label, word_end, arena);
+                    for (Node* child : children) nodes.add_child(node, child, arena);
+                    return node;
+                },
+                [this](std::span<Node* const> children) {
+                    for (Node* child : children) nodes.add_child(root, child, arena);
+                });
+            if (filter != nullptr) rebuild_filter();
+        }
+
+        // The nodes of the shards are in the same range as the ones of this trie, so they can be used as they
+        // are. Only the children of the shard roots are moved to this root, and then the policy takes over what
+        // it keeps for the nodes of the shards. The policy learns all words first, so that the shards share
+        // what it learned and do not have to change it.
+        void insert_parallel(std::span<const std::string_view> elems, size_t nbr_threads) override {
+            nodes.learn(elems);
+            std::vector<std::unique_ptr<RadixTrie>> new_shards = build_sharded<RadixTrie>(*this, elems, nbr_threads,
+                [this]() { return std::unique_ptr<RadixTrie>(new RadixTrie(arena, nodes.shard_policy())); },
+                [this](RadixTrie& shard, char letter) {
+                    Node* child = shard.nodes.find_child(shard.root, letter, shard.arena);
+                    shard.nodes.delete_child(shard.root, letter, shard.arena);
+                    nodes.add_child(root, child, arena);
+                });
+            for (std::unique_ptr<RadixTrie>& shard : new_shards)
+            {
+                nodes.take_over(shard->nodes);
+                shards.push_back(std::move(shard));
+            }
+            if (filter != nullptr) rebuild_filter();
+        }
+
+        std::unique_ptr<FrozenTrie> freeze() const override {
+            return std::make_unique<FrozenTrie>(root,
+                [this](Node* node) { return node->label.view(arena); },
+                [this](Node* node, auto f) { nodes.for_each_child(node, arena, f); });
+        }
+
+        // The label blocks of all arenas are counted, since a label of a node from a shard may have been given
+        // back to another arena than the one it came from.
+        TrieStats stats() const override {
+            TrieStats stats = collect_stats(root,
+                [this](Node* node, auto f) { nodes.for_each_child(node, arena, f); },
+                [this](Node* node, size_t nbr_children, TrieStats& stats) { nodes.account(node, nbr_children, stats); });
+            nodes.account_policy(stats);
+            stats.label_bytes = arena.used_label_bytes();
+            for (const std::unique_ptr<RadixTrie>& shard : shards) stats.label_bytes = stats.label_bytes + shard->arena.used_label_bytes();
+            return stats;
+        }
+
+        bool delete_elem(std::string_view elem) override{
+            size_t matched_characters = 0;
+            Node* current_node = root;
+            Node* grandparent_node = nullptr;
+            Node* parent_node = nullptr;
+            Node* next_node;
+            char first_letter;
+
+            while (true)
+            {
+                first_letter = letter_at(elem, matched_characters);
+                next_node = nodes.find_child(current_node, first_letter, arena);
+
+                if (next_node == nullptr)
+                {
+                    // There is no edge with the first letter of our unmatched suffix. Therefore, the word is not
+                    // in the trie and we can return false.
+                    return 0;
+                }
+                else
+                {
+                    // We now step into the next node and compare the suffix of our word with the edge of that node.
+                    // The suffix is only a view into elem, so nothing gets copied here.
+                    grandparent_node = parent_node;
+                    parent_node = current_node;
+                    current_node = next_node;
+
+                    size_t lcp = lcp_function(elem.substr(matched_characters), current_node->label.view(arena));
+                    size_t suffix_length = elem.length() - matched_characters;
+                    size_t edge_length = current_node->label.size();
+
+                    if (lcp == suffix_length)
+                    {
+                        // This means, we reached a leave and therefore the element was contained in the trie.
+                        // We now have to remove this leave and then we are done.
+
+                        // The removed node (and everything below it) goes back to the arena. Then parent_node may
+                        // be left with a single child, and is merged into it.
+                        filter_delete(current_node, elem, matched_characters);
+                        nodes.delete_child(parent_node, first_letter, arena);
+                        nodes.release(current_node, arena);
+                        merge_with_only_child(grandparent_node, parent_node);
+                        if (filter != nullptr && filter->needs_rebuild()) rebuild_filter();
+
+                        return 1;
+                    }
+                    else if (lcp == edge_length)
+                    {
+                        // This means, we can not yet make a decicion weather or not the word is in the trie.
+                        matched_characters = matched_characters + lcp;
+                    }
+                    else {
+                        // This means, that lcp is smaller then both edge_length and suffix_length, so we now that
+                        // the word is not contained in the trie.
+                        return 0;
+                    }
+
+                }
+
+            }
+
+            return 0;
+        }
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "Tries.hpp"
+#include "RadixSort.hpp"
+
+// This function inserts words into an empty trie with several threads.
+//
+// Two words with different first letters never meet in the trie, since the root already sends them to
+// different children. So the words are grouped by their first letter (keeping their order), the groups are
+// shared out between the threads, and every thread inserts its groups into a shard: a trie of its own, with
+// its own arena, that nobody else touches. In the end, move_child(shard, letter) takes every child of the
+// shard roots over into the root of the real trie, in the order in which the letters first appear in elems.
+// The arenas of the shards cut their slabs from the range of the trie (see Arena::SharedRange), so more threads
+// do not reserve more address space.
+// Every subtree sees the same inserts in the same order as before, so the trie is exactly the one the
+// sequential inserts would have built.
+//
+// The nodes still live in the arenas of the shards, so the caller has to keep the returned shards alive as
+// long as the trie. If an insert throws, the exception is thrown here after all threads finished.
+template<class T, class CreateShard, class MoveChild>
+std::vector<std::unique_ptr<T>> build_sharded(const Trie& trie, std::span<const std::string_view> elems, size_t nbr_threads,
+                                              CreateShard create_shard, MoveChild move_child) {
+    static const size_t NBR_LETTERS = 256;
+
+    std::vector<size_t> positions(elems.size());
+    for (size_t i = 0; i < elems.size(); i++) positions[i] = i;
+
+    std::vector<size_t> grouped;
+    std::vector<size_t> group_start = radix_sort::distribute(positions, grouped, nbr_threads, [&](size_t i) {
+        return (size_t) (unsigned char) trie.letter_at(elems[i], 0);
+    });
+    auto group_size = [&](size_t letter) { return group_start[letter + 1] - group_start[letter]; };
+
+    // The largest groups are handed out first, always to the thread with the least words so far.
+    std::vector<size_t> letters;
+    for (size_t letter = 0; letter < NBR_LETTERS; letter++)
+    {
+        if (group_size(letter) > 0) letters.push_back(letter);
+    }
+    std::sort(letters.begin(), letters.end(), [&](size_t a, size_t b) { return group_size(a) > group_size(b); });
+
+    std::vector<std::vector<size_t>> assigned(nbr_threads);
+    std::vector<size_t> load(nbr_threads, 0);
+    std::vector<size_t> owner(NBR_LETTERS);
+    for (size_t letter : letters)
+    {
+        size_t thread = std::min_element(load.begin(), load.end()) - load.begin();
+        assigned[thread].push_back(letter);
+        load[thread] += group_size(letter);
+        owner[letter] = thread;
+    }
+
+    std::vector<std::unique_ptr<T>> shards(nbr_threads);
+    std::vector<std::exception_ptr> exceptions(nbr_threads);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < nbr_threads; t++)
+    {
+        threads.emplace_back([&, t]() {
+            try
+            {
+                shards[t] = create_shard();
+                for (size_t letter : assigned[t])
+                {
+                    for (size_t j = group_start[letter]; j < group_start[letter + 1]; j++) shards[t]->insert(elems[grouped[j]]);
+                }
+            }
+            catch (...)
+            {
+                exceptions[t] = std::current_exception();
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    for (std::exception_ptr& exception : exceptions)
+    {
+        if (exception) std::rethrow_exception(exception);
+    }
+
+    // grouped[group_start[letter]] is the position of the first word with that letter.
+    std::sort(letters.begin(), letters.end(), [&](size_t a, size_t b) { return grouped[group_start[a]] < grouped[group_start[b]]; });
+    for (size_t letter : letters) move_child(*shards[owner[letter]], (char) letter);
+
+    return shards;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+// A bounded lock-free queue for exactly one producer thread and one consumer thread.
+//
+// The producer only writes head and the consumer only writes tail, so both sides get along with one
+// acquire load and one release store per operation. Capacity has to be a power of two. push and pop
+// spin (and yield, so that this also works when both threads share one core) while the ring is full
+// or empty.
+template<class T, size_t Capacity>
+class SpscRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity has to be a power of two");
+
+    private:
+        T slots[Capacity];
+
+        // head and tail count all pushes and pops, the slot is the count modulo Capacity. They live on
+        // separate cache lines, so that the two threads do not invalidate each others line on every
+        // operation.
+        alignas(64) std::atomic<size_t> head{0};
+        alignas(64) std::atomic<size_t> tail{0};
+
+    public:
+        bool try_push(const T& value) {
+            size_t current_head = head.load(std::memory_order_relaxed);
+            if (current_head - tail.load(std::memory_order_acquire) == Capacity) return false;
+
+            slots[current_head & (Capacity - 1)] = value;
+            head.store(current_head + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool try_pop(T& value) {
+            size_t current_tail = tail.load(std::memory_order_relaxed);
+            if (head.load(std::memory_order_acquire) == current_tail) return false;
+
+            value = slots[current_tail & (Capacity - 1)];
+            tail.store(current_tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        void push(const T& value) {
+            while (!try_push(value)) std::this_thread::yield();
+        }
+
+        T pop() {
+            T value;
+            while (!try_pop(value)) std::this_thread::yield();
+            return value;
+        }
+};
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "Tries.hpp"
+#include "FixedSize.cpp"
+#include "VariableSizeTrie.cpp"
+#include "HashTableTrie.cpp"
+#include "AdaptiveRadixTrie.cpp"
+#include "ConcurrentTrie.cpp"
+#include "BurstTrie.cpp"
+
+// The regression tests of the tries, run by ctest. Every test runs on all six variants and prints a FAIL line for
+// every check that does not hold. The program returns 1 if there was one.
+
+static const char* VARIANT_NAMES[] = {"", "fixed_size_array_trie", "variable_size_array_trie", "hash_table_trie",
+                                      "adaptive_radix_trie", "concurrent_trie", "burst_trie"};
+
+static std::unique_ptr<Trie> make_trie(int version_nbr) {
+    switch (version_nbr)
+    {
+        case 1: return std::make_unique<FixedSizeArrayTrie>();
+        case 2: return std::make_unique<VariableSizeArrayTrie>();
+        case 3: return std::make_unique<HashTableTrie>();
+        case 4: return std::make_unique<AdaptiveRadixTrie>();
+        case 5: return std::make_unique<ConcurrentTrie>();
+        default: return std::make_unique<BurstTrie>();
+    }
+}
+
+static size_t nbr_failures = 0;
+
+static void check(bool condition, const std::string& test, int version_nbr, const std::string& what) {
+    if (condition) return;
+    std::cout << "FAIL " << test << " variant=" << VARIANT_NAMES[version_nbr] << ": " << what << std::endl;
+    nbr_failures++;
+}
+
+// A word, that is inserted after a longer word beginning with it, is a word of its own: insert returns true
+// for it, and it stays in the trie when the longer word is deleted, no matter in which order both came. It
+// ends once at the end of a label and once inside of one.
+static void test_prefix_inserted_after_extension(int version_nbr) {
+    const std::string test = "prefix_inserted_after_extension";
+    for (std::string prefix : {"ab", "abc"})
+    {
+        for (bool prefix_first : {false, true})
+        {
+            std::unique_ptr<Trie> trie = make_trie(version_nbr);
+            trie->insert("abcde");
+            trie->insert("abx");
+            if (prefix_first) check(trie->insert(prefix), test, version_nbr, "insert " + prefix + " before abcd");
+            check(trie->insert("abcd"), test, version_nbr, "insert abcd");
+            if (!prefix_first) check(trie->insert(prefix), test, version_nbr, "insert " + prefix + " after abcd");
+            check(!trie->insert(prefix), test, version_nbr, "insert " + prefix + " a second time");
+
+            check(trie->delete_elem("abcd"), test, version_nbr, "delete abcd");
+            check(trie->contains(prefix), test, version_nbr, prefix + " is gone after deleting abcd");
+            check(!trie->contains("abcd"), test, version_nbr, "abcd is still there");
+            check(trie->contains("abx"), test, version_nbr, "abx is gone after deleting abcd");
+
+            check(trie->delete_elem(prefix), test, version_nbr, "delete " + prefix);
+            check(!trie->contains(prefix), test, version_nbr, prefix + " is still there");
+            check(trie->contains("ab") == (prefix == "ab" ? 0 : 1), test, version_nbr, "ab after deleting " + prefix);
+        }
+    }
+}
+
+// bulk_load has to build the same trie as inserting the words one after another, also when some words are
+// prefixes of others: in sorted order a prefix always comes before its extensions, while the inserts here see
+// every extension first. Both tries then answer the same querries, deletes and inserts included.
+static void test_bulk_load_matches_insert(int version_nbr) {
+    const std::string test = "bulk_load_matches_insert";
+    std::mt19937_64 rng(version_nbr);
+    std::uniform_int_distribution<int> letter('a', 'd');
+
+    std::vector<std::string> words;
+    for (size_t i = 0; i < 300; i++)
+    {
+        std::string word(1 + rng() % 8, 'a');
+        for (char& c : word) c = (char) letter(rng);
+        words.push_back(word);
+        words.push_back(word.substr(0, 1 + rng() % word.length()));
+    }
+
+    std::vector<std::string_view> sorted(words.begin(), words.end());
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    std::unique_ptr<Trie> inserted = make_trie(version_nbr);
+    for (std::string_view word : words) inserted->insert(word);
+    std::unique_ptr<Trie> bulk_loaded = make_trie(version_nbr);
+    bulk_loaded->bulk_load(sorted);
+
+    for (size_t i = 0; i < 2000; i++)
+    {
+        std::string word(1 + rng() % 8, 'a');
+        for (char& c : word) c = (char) letter(rng);
+        size_t type = rng() % 6;
+        bool inserted_result, bulk_result;
+        if (type == 0)
+        {
+            inserted_result = inserted->delete_elem(word);
+            bulk_result = bulk_loaded->delete_elem(word);
+        }
+        else if (type == 1)
+        {
+            inserted_result = inserted->insert(word);
+            bulk_result = bulk_loaded->insert(word);
+        }
+        else
+        {
+            inserted_result = inserted->contains(word);
+            bulk_result = bulk_loaded->contains(word);
+        }
+        check(inserted_result == bulk_result, test, version_nbr, "querry " + std::to_string(i) + " type " + std::to_string(type) + " for " + word);
+    }
+}
+
+// Every lcp kernel has to agree with lcp_scalar for every length up to 300 and every mismatch position
+// (including none). The strings are copied to exactly length bytes, so that a kernel reading behind the end would
+// be caught by the address sanitizer.
+static void test_lcp_kernels() {
+    std::vector<std::pair<std::string, LcpKernel>> kernels;
+    kernels.emplace_back("word", lcp_word);
+#if defined(__SSE2__)
+    kernels.emplace_back("sse2", lcp_sse2);
+    if (__builtin_cpu_supports("avx2")) kernels.emplace_back("avx2", lcp_avx2);
+#endif
+    kernels.emplace_back("fast", lcp_fast);
+
+    const size_t max_length = 300;
+    std::mt19937 random(42);
+    std::string str1(max_length, 0);
+    for (char& c : str1) c = 'a' + random() % 26;
+
+    for (auto& [name, kernel] : kernels)
+    {
+        for (size_t length = 0; length <= max_length; length++)
+        {
+            for (size_t mismatch = 0; mismatch <= length; mismatch++)
+            {
+                std::string str2 = str1.substr(0, length);
+                if (mismatch < length) str2[mismatch] = str2[mismatch] ^ 0x80;
+                std::string prefix = str1.substr(0, length);
+
+                size_t expected = lcp_scalar(prefix.data(), str2.data(), length);
+                if (expected == mismatch && kernel(prefix.data(), str2.data(), length) == expected) continue;
+                std::cout << "FAIL lcp_kernels kernel=" << name << ": wrong for length " << length
+                          << " and mismatch " << mismatch << std::endl;
+                nbr_failures++;
+            }
+        }
+    }
+}
+
+int main() {
+    test_lcp_kernels();
+    for (int version_nbr = 1; version_nbr <= 6; version_nbr++)
+    {
+        test_prefix_inserted_after_extension(version_nbr);
+        test_bulk_load_matches_insert(version_nbr);
+    }
+
+    if (nbr_failures > 0)
+    {
+        std::cout << nbr_failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "all tests passed" << std::endl;
+    return 0;
+}
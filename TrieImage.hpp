@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The binary format of a FrozenTrie on disk (written with -save=, opened with -load=).
+//
+// The file is a header followed by the arrays of the frozen trie, each one starting at a multiple of 64
+// bytes. The header only stores offsets from the start of the file, never addresses, so the file can be
+// memory mapped anywhere and queried in place, without reading it into other data structures first.
+//
+// The header has a checksum of its own, and one over everything behind it. A file written by another
+// version of the format, or on a machine with another byte order, is rejected.
+namespace trie_image {
+    static const char MAGIC[8] = {'T', 'I', '_', 'T', 'R', 'I', 'E', 0};
+    static const uint32_t FORMAT_VERSION = 1;
+    static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+    static const size_t ALIGNMENT = 64;
+
+    enum Section { LOUDS_WORDS, LOUDS_BLOCK_RANKS, LOUDS_ZERO_BLOCKS, KEYS, LABEL_STARTS, LABELS, NBR_SECTIONS };
+
+    struct SectionEntry {
+        uint64_t offset;
+        uint64_t size;      // in bytes
+    };
+
+    struct Header {
+        char magic[8];
+        uint32_t format_version;
+        uint32_t byte_order;
+        uint64_t file_size;
+        uint64_t nbr_nodes;
+        uint64_t nbr_bits;
+        SectionEntry sections[NBR_SECTIONS];
+        uint64_t payload_checksum;
+        uint64_t header_checksum;   // over the header with this field set to 0
+    };
+
+    static_assert(sizeof(Header) <= ALIGNMENT * 3, "The header has to fit in front of the first section");
+    static const size_t PAYLOAD_OFFSET = (sizeof(Header) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+    // A simple 64 bit checksum, that reads 8 bytes at a time in four independent lanes, so that it runs
+    // at memory speed. It is meant to find damaged or truncated files, not to resist attacks.
+    inline uint64_t checksum(const char* data, size_t size) {
+        const uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+        const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+        uint64_t lanes[4] = {PRIME1, PRIME2, ~PRIME1, ~PRIME2};
+
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32)
+        {
+            for (size_t lane = 0; lane < 4; lane++)
+            {
+                uint64_t word;
+                std::memcpy(&word, data + i + lane * 8, 8);
+                lanes[lane] = (lanes[lane] ^ word) * PRIME1;
+                lanes[lane] = (lanes[lane] << 31) | (lanes[lane] >> 33);
+            }
+        }
+
+        uint64_t hash = size * PRIME2;
+        for (size_t lane = 0; lane < 4; lane++) hash = (hash ^ lanes[lane]) * PRIME2;
+        for (; i < size; i++) hash = (hash ^ (unsigned char) data[i]) * PRIME1;
+        return hash ^ (hash >> 29);
+    }
+
+    inline uint64_t header_checksum(Header header) {
+        header.header_checksum = 0;
+        return checksum((const char*) &header, sizeof(Header));
+    }
+
+    // This function checks that data is a complete image of this format and returns its header. The checksum
+    // over the arrays needs to read the whole file, so it can be skipped.
+    inline const Header& check(const char* data, size_t size, bool verify_payload) {
+        if (size < PAYLOAD_OFFSET) throw std::runtime_error("The trie image is too short");
+
+        const Header& header = *(const Header*) data;
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) throw std::runtime_error("The file is not a trie image");
+        if (header.byte_order != BYTE_ORDER_MARK) throw std::runtime_error("The trie image was written with another byte order");
+        if (header.format_version != FORMAT_VERSION)
+        {
+            throw std::runtime_error("Unsupported trie image version: " + std::to_string(header.format_version));
+        }
+        if (header.header_checksum != header_checksum(header)) throw std::runtime_error("The header of the trie image is damaged");
+        if (header.file_size != size) throw std::runtime_error("The trie image has the wrong size");
+
+        for (const SectionEntry& section : header.sections)
+        {
+            if (section.offset % ALIGNMENT != 0 || section.offset < PAYLOAD_OFFSET || section.offset > size || section.size > size - section.offset)
+            {
+                throw std::runtime_error("The trie image has an invalid section");
+            }
+        }
+
+        if (verify_payload && header.payload_checksum != checksum(data + PAYLOAD_OFFSET, size - PAYLOAD_OFFSET))
+        {
+            throw std::runtime_error("The trie image is damaged");
+        }
+        return header;
+    }
+
+    // A file that is memory mapped read only for as long as this object lives.
+    class MappedFile {
+        private:
+            const char* mapping = nullptr;
+            size_t mapping_size = 0;
+
+        public:
+            explicit MappedFile(const std::string& file_name) {
+                int fd = open(file_name.c_str(), O_RDONLY);
+                if (fd < 0) throw std::runtime_error("The trie image " + file_name + " can not be opened");
+
+                struct stat file_stat;
+                if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+                {
+                    close(fd);
+                    throw std::runtime_error("The trie image " + file_name + " is empty");
+                }
+
+                void* ptr = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                close(fd);
+                if (ptr == MAP_FAILED) throw std::runtime_error("The trie image " + file_name + " can not be mapped");
+
+                mapping = (const char*) ptr;
+                mapping_size = file_stat.st_size;
+            }
+
+            ~MappedFile() {
+                munmap((void*) mapping, mapping_size);
+            }
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            const char* data() const { return mapping; }
+            size_t size() const { return mapping_size; }
+    };
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+
+// The structure of a trie, as returned by Trie::stats.
+//
+// The bytes are the ones the trie really holds, with the rounding of the arena or malloc, so they can be compared
+// across the variants. Memory that the variants only reserve and never touch (like the range of the arena) is not
+// counted, see the RSS in main.cpp for that.
+struct TrieStats {
+    struct NodeType {
+        size_t count = 0;
+        size_t bytes = 0;
+    };
+
+    size_t nbr_nodes = 0;
+    size_t nbr_word_ends = 0;
+    std::map<std::string, NodeType> node_types;     // the number and bytes of the nodes of every layout
+    size_t label_bytes = 0;                         // bytes of edge labels, that are not stored in the nodes
+    size_t child_slack_bytes = 0;                   // bytes of child slots (or buckets) that hold no child
+    std::vector<size_t> depth_histogram;            // number of nodes for every depth, the root has depth 0
+    std::vector<size_t> fan_out_histogram;          // number of nodes for every number of children
+
+    void add_node(const std::string& type, size_t bytes) {
+        NodeType& node_type = node_types[type];
+        node_type.count++;
+        node_type.bytes = node_type.bytes + bytes;
+    }
+
+    size_t node_bytes() const {
+        size_t bytes = 0;
+        for (const auto& node_type : node_types) bytes = bytes + node_type.second.bytes;
+        return bytes;
+    }
+
+    // This function prints the statistics as lines of key=value pairs, like the RESULT line of main.cpp.
+    void print(std::ostream& out) const {
+        out << "STATS nodes=" << nbr_nodes
+            << " word_ends=" << nbr_word_ends
+            << " node_bytes=" << node_bytes()
+            << " label_bytes=" << label_bytes
+            << " child_slack_bytes=" << child_slack_bytes << std::endl;
+
+        for (const auto& node_type : node_types)
+        {
+            out << "STATS node_type=" << node_type.first
+                << " count=" << node_type.second.count
+                << " bytes=" << node_type.second.bytes << std::endl;
+        }
+
+        out << "STATS depth_histogram=";
+        print_histogram(out, depth_histogram);
+        out << "STATS fan_out_histogram=";
+        print_histogram(out, fan_out_histogram);
+    }
+
+    private:
+        // Only the non-empty entries are printed, as value:count.
+        static void print_histogram(std::ostream& out, const std::vector<size_t>& histogram) {
+            bool first = true;
+            for (size_t i = 0; i < histogram.size(); i++)
+            {
+                if (histogram[i] == 0) continue;
+                out << (first ? "" : ",") << i << ":" << histogram[i];
+                first = false;
+            }
+            out << std::endl;
+        }
+};
+
+// This function walks the trie from root and fills the counts, the word ends and both histograms of the
+// statistics. Every variant only gives the walk to the children (for_each_child(node, f)) and the function
+// account(node, nbr_children, stats), which adds the bytes of one node. Node can be a pointer or a number.
+template<class Node, class ForEachChild, class Account>
+TrieStats collect_stats(Node root, ForEachChild for_each_child, Account account) {
+    TrieStats stats;
+    std::vector<std::pair<Node, size_t>> stack;
+    stack.push_back({root, 0});
+
+    while (!stack.empty())
+    {
+        auto [node, depth] = stack.back();
+        stack.pop_back();
+
+        size_t nbr_children = 0;
+        for_each_child(node, [&](Node child) {
+            stack.push_back({child, depth + 1});
+            nbr_children++;
+        });
+
+        stats.nbr_nodes++;
+        if (stats.depth_histogram.size() <= depth) stats.depth_histogram.resize(depth + 1);
+        stats.depth_histogram[depth]++;
+        if (stats.fan_out_histogram.size() <= nbr_children) stats.fan_out_histogram.resize(nbr_children + 1);
+        stats.fan_out_histogram[nbr_children]++;
+        account(node, nbr_children, stats);
+    }
+    return stats;
+}
+
+// This function returns the resident set size of the process right now.
+inline size_t current_rss_bytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0;
+    size_t resident_pages = 0;
+    statm >> pages >> resident_pages;
+    return resident_pages * sysconf(_SC_PAGESIZE);
+}
+
+// This function returns the highest resident set size the process had so far. Linux counts ru_maxrss in KiB.
+inline size_t peak_rss_bytes() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (size_t) usage.ru_maxrss * 1024;
+}
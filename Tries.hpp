@@ -1,23 +1,95 @@
 #pragma once
 
+#include <memory>
 #include <string>
+#include <string_view>
+#include <span>
+#include <vector>
+#include "Lcp.hpp"
+#include "TrieStats.hpp"
+
+class FrozenTrie;
+class PrefixFilter;
 
 class Trie {
     public: 
         virtual ~Trie() = default;
-        virtual bool contains(std::string& elem) const =0;
-        virtual bool delete_elem(std::string& elem) =0;
-        virtual bool insert(std::string& elem) =0;
+        virtual bool contains(std::string_view elem) const =0;
+        virtual bool delete_elem(std::string_view elem) =0;
+        virtual bool insert(std::string_view elem) =0;
 
-        size_t lcp_function(const std::string& str1, const std::string& str2) const {
-            size_t minLength = std::min(str1.length(), str2.length());
-            size_t i = 0;
+        // This function answers contains for every word of elems and stores the answer at the same position in
+        // results. The tries override it with an interleaved version (see BatchLookup.hpp), only BurstTrie
+        // uses this loop.
+        virtual void contains_batch(std::span<const std::string_view> elems, std::vector<bool>& results) const {
+            results.resize(elems.size());
+            for (size_t i = 0; i < elems.size(); i++)
+            {
+                results[i] = contains(elems[i]);
+            }
+        }
+
+        // This function answers contains for every word of elems like contains_batch. RadixTrie and
+        // AdaptiveRadixTrie override it with a lookup in sorted order, in which words with a common prefix
+        // share their walk from the root (see sorted_contains in BatchLookup.hpp).
+        virtual void contains_sorted(std::span<const std::string_view> elems, std::vector<bool>& results) const {
+            contains_batch(elems, results);
+        }
+
+        // This function lets an empty trie see the text of the input file (one word per line) before the words
+        // are inserted, so that it can prepare for their letters. FixedSizeArrayTrie learns its alphabet from it
+        // (see Alphabet.hpp), the other tries do not need it.
+        virtual void learn_alphabet(std::string_view) {}
+
+        // This function puts a filter of all prefixes in the trie in front of contains, so that most words
+        // that are not in the trie are answered without a walk (see PrefixFilter.hpp). The filter is sized for
+        // the words the trie holds now and stays in sync with later inserts and deletes. Only the tries of
+        // RadixTrie.hpp have one, the others return false.
+        virtual bool use_filter() { return 0; }
 
-            while (i < minLength && str1[i] == str2[i]) {
-                i++;
+        // This function returns the filter of use_filter, or nullptr if the trie has none.
+        virtual const PrefixFilter* prefix_filter() const { return nullptr; }
+
+        // This function fills an empty trie with the given words, which have to be sorted and must not contain
+        // duplicates (see sort_words in RadixSort.hpp). The result is the same as inserting them one after
+        // another. The tries override it with a bottom-up build that never splits a node (see BulkLoad.hpp),
+        // only BurstTrie inserts the words one after another.
+        virtual void bulk_load(std::span<const std::string_view> elems) {
+            for (std::string_view elem : elems)
+            {
+                insert(elem);
             }
+        }
 
-            return i;
+        // This function inserts the words into an empty trie, with the same result as inserting them one after
+        // another, but it may use nbr_threads threads for that. The tries override it with a build that inserts
+        // the words of every first letter into a separate subtrie (see ShardedBuild.hpp), only BurstTrie uses
+        // a single thread.
+        virtual void insert_parallel(std::span<const std::string_view> elems, size_t) {
+            for (std::string_view elem : elems)
+            {
+                insert(elem);
+            }
         }
-};
 
+        // This function makes a read-only copy of the trie in the succinct layout of FrozenTrie.hpp, that
+        // answers contains like this trie, but needs much less memory.
+        virtual std::unique_ptr<FrozenTrie> freeze() const =0;
+
+        // This function walks the trie and returns its structure: the number and bytes of its nodes, the bytes of
+        // its labels and unused child slots and the histograms of depth and fan-out (see TrieStats.hpp).
+        virtual TrieStats stats() const =0;
+
+        // This function compares the two strings in place and returns the length of their longest common prefix.
+        // It uses the vectorized kernels from Lcp.hpp.
+        size_t lcp_function(std::string_view str1, std::string_view str2) const {
+            size_t minLength = std::min(str1.length(), str2.length());
+            return lcp_fast(str1.data(), str2.data(), minLength);
+        }
+
+        // This function returns the letter at the given position of the word. Behind the last letter it returns
+        // the 0 byte, like a std::string would, so that the empty word still selects a child.
+        char letter_at(std::string_view elem, size_t pos) const {
+            return pos < elem.length() ? elem[pos] : 0;
+        }
+};
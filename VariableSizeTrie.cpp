@@ -1,246 +1,156 @@
-#include "Tries.hpp"
-#include <iostream>
-
-class VariableSizeArrayTrie : public Trie {
+#include "RadixTrie.hpp"
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// The node policy of VariableSizeArrayTrie (see RadixTrie.hpp).
+//
+// Every node has one block in the arena with two arrays: the first letters of the labels of its children (the
+// keys), and behind them the arena indices of the children in the same order. So find_child only compares the
+// keys, 16 at once with SSE2, and then loads the one child it found, instead of loading every child to look at
+// its label. The capacity of the arrays doubles when they are full and halves when they are only a quarter full,
+// so adding or deleting a child does not move the block every time.
+class VariableSizeNodes {
     private:
+        static const size_t MIN_CAPACITY = 2;
+
+    public:
         struct Node {
-            private:
-                int8_t nbr_children = 0;
-                Node** children;
+            EdgeLabel label;
+            bool word_end;              // if a word ends at the end of the label (and not only passes through)
+            uint16_t nbr_children = 0;
+            uint16_t capacity = 0;
+            uint32_t block = 0;         // the arena index of capacity keys, padded to 4 bytes, and then capacity
+                                        // children indices
 
-            public: 
-                std::string comp_edge_label;
+            Node(EdgeLabel edge_label, bool word_end, Arena&) : label(edge_label), word_end(word_end) {}
 
-                Node(std::string edge_label) {
-                    children = nullptr;
-                    comp_edge_label = edge_label;
-                }
+            Node(std::string_view edge_label, bool word_end, Arena& arena) : Node(EdgeLabel(edge_label, arena), word_end, arena) {}
+        };
 
-                ~Node() { free(children); }
+    private:
+        static size_t keys_bytes(size_t capacity) { return (capacity + 3) / 4 * 4; }
 
-                // This function adds a child to the node and stores a pointer to it.
-                void add_child(Node* child_ptr) {
-                    nbr_children++;
-                    children = (Node**) realloc(children, nbr_children * sizeof(Node*));
-                    children[nbr_children-1] = child_ptr;
-                }
+        static size_t block_size(size_t capacity) { return keys_bytes(capacity) + capacity * sizeof(uint32_t); }
 
-                // This function checks if there is an edge to a child, that begins with a given letter.
-                Node* find_child(char letter) {
-                    for (size_t i = 0; i < nbr_children; i++)
-                    {
-                        if (children[i]->comp_edge_label[0] == letter)
-                        {
-                            return children[i];
-                        }
-                        
-                    }
-                    return nullptr;
-                }
+        static uint8_t* keys_of(Node* node, const Arena& arena) { return arena.at_index<uint8_t>(node->block); }
 
-                // This functions delets the child, whoms edge starts with the given letter.
-                void delete_child(char letter) {
-                    Node* child = find_child(letter);
-                    Node* swap_pointer; 
-                    for (size_t i = 0; i < nbr_children; i++)
-                    {
-                        if (children[i]->comp_edge_label[0] == letter)
-                        {
-                            child = children[i];
-                            swap_pointer = children[nbr_children-1];
-                            children[nbr_children-1] = child;
-                            children[i] = swap_pointer;
-                            nbr_children--;
-                            children = (Node**) realloc(children, nbr_children * sizeof(Node*));
-                        }
-                        
-                    }
-                    
-                }
-        };
+        static uint32_t* children_of(Node* node, const Arena& arena) {
+            return (uint32_t*) (keys_of(node, arena) + keys_bytes(node->capacity));
+        }
 
-        Node *root = new Node("");
+        // This function moves the keys and children of the node into a new block with the given capacity.
+        static void resize(Node* node, size_t capacity, Arena& arena) {
+            uint8_t* block = capacity == 0 ? nullptr : (uint8_t*) arena.allocate(block_size(capacity));
+            if (node->nbr_children > 0)
+            {
+                std::memcpy(block, keys_of(node, arena), node->nbr_children);
+                std::memcpy(block + keys_bytes(capacity), children_of(node, arena), node->nbr_children * sizeof(uint32_t));
+            }
+            arena.deallocate(keys_of(node, arena), block_size(node->capacity));
+            node->block = arena.index_of(block);
+            node->capacity = (uint16_t) capacity;
+        }
 
     public:
-
-        bool insert(std::string &elem) override {
-            size_t matched_characters = 0;
-            Node* current_node = root;
-            Node* parent_node;
-            Node* new_leave_node;
-            Node* next_node;
-            char first_letter;
-
-            while (true)        
+        size_t nbr_children(Node* node, const Arena&) const { return node->nbr_children; }
+
+        // This function checks if there is an edge to a child, that begins with a given letter. With SSE2 it
+        // reads the keys in steps of 16 bytes. A block is at least 16 bytes (the smallest size class of the
+        // arena) and a capacity above 16 is a multiple of 16, so it never reads behind the block, and the keys
+        // behind the last child are masked out.
+        Node* find_child(Node* node, char letter, const Arena& arena) const {
+            const uint8_t* keys = keys_of(node, arena);
+            size_t count = node->nbr_children;
+#if defined(__SSE2__)
+            __m128i key = _mm_set1_epi8(letter);
+            for (size_t i = 0; i < count; i += 16)
             {
-                first_letter = elem[matched_characters];
-                next_node = current_node->find_child(first_letter);
-
-                if (next_node == nullptr)
-                {   
-                    // There is no edge with the first letter of our unmatched suffix. Therefore, the word is not
-                    // in the trie and we can add it here.
-                    current_node->add_child(new Node(elem.substr(matched_characters)));
-                    return 1;
-                }
-                else
-                {
-                    // We now step into the next node and compare the suffix of our word with the edge of that node.
-                    parent_node = current_node;
-                    current_node = next_node;
-
-                    size_t lcp = lcp_function(elem.substr(matched_characters), current_node->comp_edge_label);
-                    size_t suffix_length = elem.length() - matched_characters;
-                    size_t edge_length = current_node->comp_edge_label.length();
-
-                    if (lcp == suffix_length)
-                    {   
-                        // This means, we reached a leave and therefore the element was alredy in the trie.
-                        return 0;
-                    } 
-                    else if (lcp == edge_length)        
-                    {
-                        // This means, we can not yet make a decicion weather or not the word is in the trie.
-                        matched_characters = matched_characters + lcp;
-                    }
-                    else {
-                        // This means, that lcp is smaller then both edge_length and suffix_length, so we now that 
-                        // the word is not in the trie and we can insert it here.
-                        //
-                        // For that, we now have to split the current_node at lcp and make two child nodes.
-                        // One of the two new nodes will be the a leave (no children) and on its edge we write the 
-                        // unmatched suffix of our word. The other will have the unmatched suffix of the edge label 
-                        // and its children are going to be the children of the current node.
-
-                        // Create new leave and name it accordingly.
-                        new_leave_node = new Node(elem.substr(matched_characters + lcp));
-
-                        // Create new intermediate node and name it accordingly.
-                        current_node = new Node(current_node->comp_edge_label.substr(0,lcp));
-
-                        // Rename the label of the next_node accordingly.
-                        next_node->comp_edge_label = next_node->comp_edge_label.substr(lcp);
-
-                        // Make this new intermediate node the child of the parent_node.
-                        parent_node->delete_child(first_letter);
-                        parent_node->add_child(current_node);
-
-                        // Set the children of the new intermediate node.
-                        current_node->add_child(next_node);
-                        current_node->add_child(new_leave_node); 
-
-                        return 1;
-                    }
-                    
-                }
-                
+                unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(key, _mm_loadu_si128((const __m128i*) (keys + i))));
+                if (count - i < 16) mask = mask & ((1u << (count - i)) - 1);
+                if (mask != 0) return arena.at_index<Node>(children_of(node, arena)[i + __builtin_ctz(mask)]);
             }
+#else
+            for (size_t i = 0; i < count; i++)
+            {
+                if (keys[i] == (uint8_t) letter) return arena.at_index<Node>(children_of(node, arena)[i]);
+            }
+#endif
+            return nullptr;
+        }
 
-            return 0;
+        // This function calls f for every child of the node.
+        template<class F>
+        void for_each_child(Node* node, const Arena& arena, F f) const {
+            uint32_t* children = children_of(node, arena);
+            for (size_t i = 0; i < node->nbr_children; i++)
+            {
+                f(arena.at_index<Node>(children[i]));
+            }
         }
 
-        bool contains(std::string& elem) const override {
-            size_t matched_characters = 0;
-            Node* current_node = root;
-            Node* next_node;
-            char first_letter;
+        // This function adds a child to the node and stores its first letter and its index behind the others.
+        void add_child(Node* node, Node* child_ptr, Arena& arena) {
+            if (node->nbr_children == node->capacity) resize(node, node->capacity == 0 ? MIN_CAPACITY : 2 * node->capacity, arena);
+
+            keys_of(node, arena)[node->nbr_children] = (uint8_t) child_ptr->label.first();
+            children_of(node, arena)[node->nbr_children] = arena.index_of(child_ptr);
+            node->nbr_children++;
+        }
 
-            while (true)        
+        // This functions delets the child, whoms edge starts with the given letter.
+        void delete_child(Node* node, char letter, Arena& arena) {
+            uint8_t* keys = keys_of(node, arena);
+            uint32_t* children = children_of(node, arena);
+            for (size_t i = 0; i < node->nbr_children; i++)
             {
-                first_letter = elem[matched_characters];
-                next_node = current_node->find_child(first_letter);
-
-                if (next_node == nullptr)
-                {   
-                    // There is no edge with the first letter of our unmatched suffix. Therefore, the word is not
-                    // in the trie and we can return false. 
-                    return 0;
-                }
-                else
+                if (keys[i] == (uint8_t) letter)
                 {
-                    // We now step into the next node and compare the suffix of our word with the edge of that node.
-                    current_node = next_node;
-
-                    size_t lcp = lcp_function(elem.substr(matched_characters), current_node->comp_edge_label);
-                    size_t suffix_length = elem.length() - matched_characters;
-                    size_t edge_length = current_node->comp_edge_label.length();
-
-                    if (lcp == suffix_length)
-                    {   
-                        // This means, we reached a leave and therefore the element is contained in the trie.
-                        return 1;
-                    } 
-                    else if (lcp == edge_length)        
-                    {
-                        // This means, we can not yet make a decicion weather or not the word is contained in the trie.
-                        matched_characters = matched_characters + lcp;
-                    }
-                    else {
-                        // This means, that lcp is smaller then both edge_length and suffix_length, so we now that 
-                        // the word is not contained in the trie.
-                        return 0;
-                    }
-                    
+                    // The last child takes the place of the deleted one.
+                    node->nbr_children--;
+                    keys[i] = keys[node->nbr_children];
+                    children[i] = children[node->nbr_children];
+
+                    if (node->nbr_children == 0) resize(node, 0, arena);
+                    else if (node->capacity > MIN_CAPACITY && node->nbr_children <= node->capacity / 4) resize(node, node->capacity / 2, arena);
+                    return;
                 }
-                
             }
-
-            return 0;
         }
 
-        bool delete_elem(std::string& elem) override{
-            size_t matched_characters = 0;
-            Node* current_node = root;
-            Node* parent_node;
-            Node* next_node;
-            char first_letter;
-
-            while (true)        
+        // This function gives the node, its block, its label and all of its descendants back to the arena.
+        void release(Node* node, Arena& arena) {
+            uint32_t* children = children_of(node, arena);
+            for (size_t i = 0; i < node->nbr_children; i++)
             {
-                first_letter = elem[matched_characters];
-                next_node = current_node->find_child(first_letter);
-
-                if (next_node == nullptr)
-                {   
-                    // There is no edge with the first letter of our unmatched suffix. Therefore, the word is not
-                    // in the trie and we can return false.   
-                    return 0;
-                }
-                else
-                {
-                    // We now step into the next node and compare the suffix of our word with the edge of that node.
-                    parent_node = current_node;
-                    current_node = next_node;
-
-                    size_t lcp = lcp_function(elem.substr(matched_characters), current_node->comp_edge_label);
-                    size_t suffix_length = elem.length() - matched_characters;
-                    size_t edge_length = current_node->comp_edge_label.length();
-
-                    if (lcp == suffix_length)
-                    {   
-                        // This means, we reached a leave and therefore the element was contained in the trie.
-                        // We now have to remove this leave and then we are done.
-
-                        // delete current_node;
-                        parent_node->delete_child(first_letter);
-
-                        return 1;
-                    } 
-                    else if (lcp == edge_length)        
-                    {
-                        // This means, we can not yet make a decicion weather or not the word is in the trie.
-                        matched_characters = matched_characters + lcp;
-                    }
-                    else {
-                        // This means, that lcp is smaller then both edge_length and suffix_length, so we now that 
-                        // the word is not contained in the trie.
-                        return 0;
-                    }
-                    
-                }
-                
+                release(arena.at_index<Node>(children[i]), arena);
             }
+            arena.deallocate(keys_of(node, arena), block_size(node->capacity));
+            node->label.release(arena);
+            arena.destroy(node);
+        }
+
+        // The children are found by their letters as they are, so there is nothing to learn.
+        void learn(std::span<const std::string_view>) {}
+
+        void learn(std::string_view) {}
 
-            return 0;
+        VariableSizeNodes shard_policy() const { return VariableSizeNodes(); }
+
+        // The blocks are in the nodes of the shards, there is nothing else to take over.
+        void take_over(VariableSizeNodes&) {}
+
+        // The slack are the free places of the arrays (and the rounding of the arena).
+        void account(Node* node, size_t nbr_children, TrieStats& stats) const {
+            size_t block_bytes = Arena::block_bytes(block_size(node->capacity));
+            size_t used_bytes = nbr_children * (1 + sizeof(uint32_t));
+            stats.add_node("variable_node", Arena::block_bytes(sizeof(Node)) + block_bytes);
+            stats.child_slack_bytes = stats.child_slack_bytes + block_bytes - used_bytes;
+            stats.nbr_word_ends = stats.nbr_word_ends + node->word_end;
         }
-};
\ No newline at end of file
+
+        void account_policy(TrieStats&) const {}
+};
+
+using VariableSizeArrayTrie = RadixTrie<VariableSizeNodes>;
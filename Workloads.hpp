@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Synthetic workloads for ti_bench.
+//
+// Every generator only uses letters, digits and '$', like the input files of the task, and ends every key
+// with '$' like they do. So no key is the prefix of another one. All generators are deterministic for a given
+// random generator.
+namespace workloads {
+    static const char ALPHABET[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    static const size_t ALPHABET_SIZE = sizeof(ALPHABET) - 1;
+
+    // One querry of a workload: 'c' (contains), 'i' (insert) or 'd' (delete) and its word.
+    struct Operation {
+        char type;
+        std::string word;
+    };
+
+    // This function calls make_key until it returned n different keys.
+    template<class MakeKey>
+    std::vector<std::string> unique_keys(size_t n, MakeKey make_key) {
+        std::unordered_set<std::string> seen;
+        std::vector<std::string> keys;
+        keys.reserve(n);
+        while (keys.size() < n)
+        {
+            std::string key = make_key();
+            if (seen.insert(key).second) keys.push_back(key);
+        }
+        return keys;
+    }
+
+    // Random keys of 8 to 24 letters, with hardly any common prefixes.
+    inline std::vector<std::string> uniform_keys(size_t n, std::mt19937_64& rng) {
+        return unique_keys(n, [&]() {
+            std::string key(8 + rng() % 17, ' ');
+            for (char& c : key) c = ALPHABET[rng() % ALPHABET_SIZE];
+            return key + "$";
+        });
+    }
+
+    // Keys like the URLs of the input files: a few hosts, then one to four path segments out of a small
+    // vocabulary and a random id. So they have long common prefixes and a deep trie.
+    inline std::vector<std::string> url_keys(size_t n, std::mt19937_64& rng) {
+        static const char* HOSTS[] = {"httpwwwgooglecom", "httpwwwgithubcom", "httpwwwexamplecom", "httpswikipediaorg",
+                                      "httpsnewsycombinatorcom", "httpwwwkitedu"};
+        static const char* SEGMENTS[] = {"user", "repos", "issues", "pull", "blob", "main", "src", "docs", "wiki",
+                                         "search", "images", "static", "api", "v1", "v2", "items"};
+        return unique_keys(n, [&]() {
+            std::string key = HOSTS[rng() % 6];
+            size_t nbr_segments = 1 + rng() % 4;
+            for (size_t i = 0; i < nbr_segments; i++) key += SEGMENTS[rng() % 16];
+            size_t id_length = 4 + rng() % 8;
+            for (size_t i = 0; i < id_length; i++) key += ALPHABET[rng() % ALPHABET_SIZE];
+            return key + "$";
+        });
+    }
+
+    // Decimal ids, like the primary keys of a table: mostly increasing with small random gaps, so that
+    // neighbouring keys share all but their last digits.
+    inline std::vector<std::string> numeric_keys(size_t n, std::mt19937_64& rng) {
+        uint64_t id = 1000000000ull + rng() % 1000000000ull;
+        return unique_keys(n, [&]() {
+            id = id + 1 + rng() % 16;
+            return std::to_string(id) + "$";
+        });
+    }
+
+    // This class draws ranks from 0 to n-1 with a Zipf distribution, rank r with a probability proportional
+    // to 1 / (r+1)^skew. A few ranks are drawn very often, like the popular keys of a cache.
+    class ZipfGenerator {
+        private:
+            std::vector<double> cumulative;
+
+        public:
+            ZipfGenerator(size_t n, double skew) : cumulative(n) {
+                double sum = 0;
+                for (size_t r = 0; r < n; r++)
+                {
+                    sum = sum + 1.0 / std::pow((double) (r + 1), skew);
+                    cumulative[r] = sum;
+                }
+                for (double& c : cumulative) c = c / sum;
+            }
+
+            size_t operator()(std::mt19937_64& rng) {
+                double u = std::uniform_real_distribution<double>(0, 1)(rng);
+                size_t rank = std::lower_bound(cumulative.begin(), cumulative.end(), u) - cumulative.begin();
+                return std::min(rank, cumulative.size() - 1);
+            }
+    };
+
+    // Contains querries, hit_percent of them for random keys and the rest for misses.
+    inline std::vector<Operation> lookups(const std::vector<std::string>& keys, const std::vector<std::string>& misses,
+                                          size_t nbr_operations, size_t hit_percent, std::mt19937_64& rng) {
+        std::vector<Operation> operations;
+        operations.reserve(nbr_operations);
+        for (size_t i = 0; i < nbr_operations; i++)
+        {
+            if (rng() % 100 < hit_percent) operations.push_back(Operation{'c', keys[rng() % keys.size()]});
+            else operations.push_back(Operation{'c', misses[rng() % misses.size()]});
+        }
+        return operations;
+    }
+
+    // Contains querries for keys with Zipf distributed popularity. Which key is how popular is random.
+    inline std::vector<Operation> zipf_lookups(const std::vector<std::string>& keys, size_t nbr_operations, double skew, std::mt19937_64& rng) {
+        std::vector<size_t> order(keys.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = i;
+        std::shuffle(order.begin(), order.end(), rng);
+
+        ZipfGenerator zipf(keys.size(), skew);
+        std::vector<Operation> operations;
+        operations.reserve(nbr_operations);
+        for (size_t i = 0; i < nbr_operations; i++) operations.push_back(Operation{'c', keys[order[zipf(rng)]]});
+        return operations;
+    }
+
+    // A mix of insert, delete and contains querries with the given percentages (the rest are contains). Inserts
+    // take new keys from fresh_keys, deletes and contains pick among all keys inserted so far, so a part of
+    // them misses because the key was deleted before.
+    inline std::vector<Operation> mixed_operations(const std::vector<std::string>& keys, const std::vector<std::string>& fresh_keys,
+                                                   size_t nbr_operations, size_t insert_percent, size_t delete_percent, std::mt19937_64& rng) {
+        std::vector<const std::string*> known;
+        for (const std::string& key : keys) known.push_back(&key);
+        size_t next_fresh = 0;
+
+        std::vector<Operation> operations;
+        operations.reserve(nbr_operations);
+        for (size_t i = 0; i < nbr_operations; i++)
+        {
+            size_t percent = rng() % 100;
+            if (percent < insert_percent && next_fresh < fresh_keys.size())
+            {
+                known.push_back(&fresh_keys[next_fresh]);
+                operations.push_back(Operation{'i', fresh_keys[next_fresh++]});
+            }
+            else if (percent < insert_percent + delete_percent)
+            {
+                operations.push_back(Operation{'d', *known[rng() % known.size()]});
+            }
+            else
+            {
+                operations.push_back(Operation{'c', *known[rng() % known.size()]});
+            }
+        }
+        return operations;
+    }
+}
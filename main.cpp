@@ -1,16 +1,81 @@
 #include <iostream>
 #include <fstream>
 #include <filesystem>
-#include <sys/time.h>
-#include <sys/resource.h>
 #include <chrono>
 #include "Tries.hpp"
+#include "InputFile.hpp"
+#include "QueryPipeline.hpp"
+#include "RadixSort.hpp"
 #include "FixedSize.cpp"
 #include "VariableSizeTrie.cpp"
 #include "HashTableTrie.cpp"
+#include "AdaptiveRadixTrie.cpp"
+#include "ConcurrentTrie.cpp"
+#include "BurstTrie.cpp"
 
 static const bool DEBUG_OUTPUT = true;
 
+// This function reads all lines of the file. If the file is not memory mapped, the lines are only valid until
+// the next line is read, so they are copied into storage first and the views point into it.
+static std::vector<std::string_view> read_words(InputFile& input, std::string& storage) {
+    std::vector<std::string_view> words;
+    std::vector<size_t> word_ends;
+    std::string_view line;
+
+    while (input.next_line(line))
+    {
+        if (input.is_mapped())
+        {
+            words.push_back(line);
+        }
+        else
+        {
+            storage.append(line);
+            word_ends.push_back(storage.length());
+        }
+    }
+
+    size_t word_begin = 0;
+    for (size_t word_end : word_ends)
+    {
+        words.push_back(std::string_view(storage).substr(word_begin, word_end - word_begin));
+        word_begin = word_end;
+    }
+    return words;
+}
+
+// This function checks if the querry file only contains contains querries, so that the trie is not changed
+// anymore and can be frozen. Pipes can only be read once, so they are never checked.
+static bool only_contains_querries(const char* file_name) {
+    InputFile querry(file_name);
+    if (!querry.is_mapped()) return false;
+
+    std::string_view line;
+    std::string_view word;
+    std::string_view querry_type;
+    while (querry.next_line(line))
+    {
+        split_querry(line, word, querry_type);
+        if (querry_type != "c") return false;
+    }
+    return true;
+}
+
+// This function calls f with the trie as its own class instead of the Trie interface. All trie classes are final,
+// so the calls of f to the trie are no virtual calls and can be inlined. The variant is only looked up here,
+// once per phase, and not once per word or querry.
+template<class F>
+static void with_trie_class(Trie& trie, F f) {
+    if (FixedSizeArrayTrie* t = dynamic_cast<FixedSizeArrayTrie*>(&trie)) f(*t);
+    else if (VariableSizeArrayTrie* t = dynamic_cast<VariableSizeArrayTrie*>(&trie)) f(*t);
+    else if (HashTableTrie* t = dynamic_cast<HashTableTrie*>(&trie)) f(*t);
+    else if (AdaptiveRadixTrie* t = dynamic_cast<AdaptiveRadixTrie*>(&trie)) f(*t);
+    else if (ConcurrentTrie* t = dynamic_cast<ConcurrentTrie*>(&trie)) f(*t);
+    else if (BurstTrie* t = dynamic_cast<BurstTrie*>(&trie)) f(*t);
+    else if (FrozenTrie* t = dynamic_cast<FrozenTrie*>(&trie)) f(*t);
+    else f(trie);
+}
+
 int main(int argc, char* argv[]) {
 
     // Some variables for messurments and the command line output at the end of the test.
@@ -25,15 +90,17 @@ int main(int argc, char* argv[]) {
     std::chrono::_V2::system_clock::time_point start;
     std::chrono::_V2::system_clock::time_point end;
 
-    struct rusage usage;
-    getrusage(RUSAGE_SELF, &usage);
+    // The resident memory is sampled at the end of every phase, the one of the trie is the growth during its
+    // construction.
+    size_t startup_rss = current_rss_bytes();
+    size_t startup_peak = peak_rss_bytes();
 
 
 
     // This section parses the programm arguments and checks if they are valid.
     // It also chooses the requested trie_variant and creates file handles for the input, output and querry file.
 
-    if (argc != 4) throw std::invalid_argument("Unsupported number of arguments: " + (argc-1) );
+    if (argc < 4) throw std::invalid_argument("Unsupported number of arguments: " + std::to_string(argc-1));
 
     std::string version = argv[1];
     if (version.find("-version=") == std::string::npos)
@@ -44,17 +111,48 @@ int main(int argc, char* argv[]) {
     version = version.substr(version.find("=") + 1);
     std::int8_t version_nbr = version[0] - 48;
 
-    if (version_nbr > 3 || version_nbr < 1 ) throw std::invalid_argument("Unsupported version number: " + version_nbr);
+    if (version_nbr > 6 || version_nbr < 1 ) throw std::invalid_argument("Unsupported version number: " + version);
+
+    // Optional arguments follow after the three required ones.
+    bool huge_pages = false;
+    bool bulk = false;
+    bool freeze = false;
+    bool print_stats = false;
+    bool filter = false;
+    bool sorted_runs = false;
+    size_t latency_sample_rate = 0;
+    size_t nbr_threads = 0;
+    std::string save_path;
+    std::string load_path;
+
+    for (int i = 4; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if (option == "-hugepages") huge_pages = true;
+        else if (option == "-bulk") bulk = true;
+        else if (option == "-freeze") freeze = true;
+        else if (option == "-stats") print_stats = true;
+        else if (option == "-filter") filter = true;
+        else if (option == "-sorted") sorted_runs = true;
+        else if (option == "-latency") latency_sample_rate = 1;
+        else if (option.find("-latency=") == 0) latency_sample_rate = std::stoul(option.substr(9));
+        else if (option.find("-save=") == 0) save_path = option.substr(6);
+        else if (option.find("-load=") == 0) load_path = option.substr(6);
+        else if (option.find("-threads=") == 0) nbr_threads = std::stoul(option.substr(9));
+        else throw std::invalid_argument("Unsupported argument: " + option);
+    }
 
-    std::ifstream input(argv[2]);
-    std::ifstream querry(argv[3]); 
+    // Both files are memory mapped (or streamed, if they are pipes) and every line is handed to the trie
+    // as a view into the file, without copying it.
+    InputFile input(argv[2]);
+    InputFile querry(argv[3]);
     std::ofstream output("result_" + (std::string) argv[2]);
 
-    if (!input) {
+    if (!input.is_open()) {
         std::cerr << "The input_file " << argv[2] << " does not exist!" << std::endl;
         return 1;
     }
-    if (!querry) {
+    if (!querry.is_open()) {
         std::cerr << "The querry_file " << argv[3] << " does not exist!" << std::endl;
         return 1;
     }
@@ -62,25 +160,40 @@ int main(int argc, char* argv[]) {
     std::unique_ptr<Trie> trie;
     if (version_nbr == 1)
     {
-        trie = std::make_unique<FixedSizeArrayTrie>();
+        trie = std::make_unique<FixedSizeArrayTrie>(huge_pages);
         trie_variant = "fixed_size_array_trie";
     }
     if (version_nbr == 2)
     {
-        trie = std::make_unique<VariableSizeArrayTrie>();
+        trie = std::make_unique<VariableSizeArrayTrie>(huge_pages);
         trie_variant = "variable_size_array_trie";
     }
     if (version_nbr == 3)
     {
-        trie = std::make_unique<HashTableTrie>();
+        trie = std::make_unique<HashTableTrie>(huge_pages);
         trie_variant = "hash_table_trie";
     }
+    if (version_nbr == 4)
+    {
+        trie = std::make_unique<AdaptiveRadixTrie>(huge_pages);
+        trie_variant = "adaptive_radix_trie";
+    }
+    if (version_nbr == 5)
+    {
+        trie = std::make_unique<ConcurrentTrie>();
+        trie_variant = "concurrent_trie";
+    }
+    if (version_nbr == 6)
+    {
+        trie = std::make_unique<BurstTrie>();
+        trie_variant = "burst_trie";
+    }
 
 
 
     // TRIE CONSTRUCTION
     
-    std::string line;
+    std::string_view line;
     bool result;
 
     if(DEBUG_OUTPUT) std::cout << "Building trie:" << std::endl; // <---- print command
@@ -89,56 +202,118 @@ int main(int argc, char* argv[]) {
         
     
 
-    while (getline (input, line))
+    if (!load_path.empty())
+    {
+        // The trie image of an earlier run is memory mapped and used in place, the input file is not read at
+        // all. An image can not be changed, so the querry file must only contain contains querries.
+        if (querry.is_mapped() && !only_contains_querries(argv[3]))
+        {
+            throw std::invalid_argument("A trie loaded from an image can only answer c querries");
+        }
+        trie = std::make_unique<FrozenTrie>(load_path);
+        trie_variant = "frozen_trie";
+
+        if(DEBUG_OUTPUT) std::cout << "loaded the trie image " << load_path << std::endl; // <---- print command
+    }
+    else if (bulk)
     {
-        result = trie->insert(line);
+        // All words are read first, sorted and then given to the trie at once, which builds it bottom-up.
+        std::string storage;
+        std::vector<std::string_view> words = read_words(input, storage);
 
-        if(DEBUG_OUTPUT) std::cout << "inserted: " << line << " successfull: " << result << std::endl; // <---- print command
+        sort_words(words, nbr_threads == 0 ? std::thread::hardware_concurrency() : nbr_threads);
+        trie->bulk_load(words);
+
+        if(DEBUG_OUTPUT) std::cout << "bulk loaded " << words.size() << " different words" << std::endl; // <---- print command
+    }
+    else if (nbr_threads > 1)
+    {
+        // Every thread builds the subtries of some first letters, see ShardedBuild.hpp.
+        std::string storage;
+        std::vector<std::string_view> words = read_words(input, storage);
+
+        trie->insert_parallel(words, nbr_threads);
+
+        if(DEBUG_OUTPUT) std::cout << "inserted " << words.size() << " words with " << nbr_threads << " threads" << std::endl; // <---- print command
+    }
+    else
+    {
+        // The trie sees all words once before the inserts, to learn their letters (see Alphabet.hpp).
+        trie->learn_alphabet(input.contents());
+
+        with_trie_class(*trie, [&](auto& concrete_trie) {
+            while (input.next_line(line))
+            {
+                result = concrete_trie.insert(line);
+
+                if(DEBUG_OUTPUT) std::cout << "inserted: " << line << " successfull: " << result << std::endl; // <---- print command
+            }
+        });
     }
 
     
 
+    if (freeze && load_path.empty())
+    {
+        // The pointer based trie is replaced by its succinct copy (see FrozenTrie.hpp) and freed.
+        if (only_contains_querries(argv[3]))
+        {
+            trie = trie->freeze();
+            if(DEBUG_OUTPUT) std::cout << "froze the trie" << std::endl; // <---- print command
+        }
+        else
+        {
+            std::cerr << "The querry file contains other querries than c, so the trie is not frozen." << std::endl;
+        }
+    }
+
+    // The filter is built from the finished trie, so it is sized for the prefixes it really has.
+    if (filter)
+    {
+        if (trie->use_filter())
+        {
+            if(DEBUG_OUTPUT) std::cout << "built the prefix filter" << std::endl; // <---- print command
+        }
+        else
+        {
+            std::cerr << "This trie has no prefix filter, the querries run without one." << std::endl;
+        }
+    }
+
     end = std::chrono::high_resolution_clock::now(); // end timer
 
     trie_contruction_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-    trie_construction_memory = usage.ru_maxrss / byte_mebiByte_conversion_rate;
+    size_t construction_rss = current_rss_bytes();
+    size_t construction_peak = peak_rss_bytes();
+    trie_construction_memory = (construction_rss - std::min(startup_rss, construction_rss)) / byte_mebiByte_conversion_rate;
+
+    // The image is written outside of the measured time, a later run can start from it with -load=.
+    if (!save_path.empty()) trie->freeze()->save(save_path);
+
+    // The structure of the trie is printed outside of the measured time as well, see TrieStats.hpp.
+    if (print_stats) trie->stats().print(std::cout);
 
 
     // QUERRYS
 
      if(DEBUG_OUTPUT) std::cout << "Running Querries:" << std::endl; // <---- print command
-    int16_t sep_pos;
-    std::string word;
-    std::string querry_type;
 
     start = std::chrono::high_resolution_clock::now(); // begin timer
 
-    while (getline (querry, line))
-    {
-        sep_pos = line.find(" ");
-        word = line.substr(0, sep_pos);
-        querry_type = line.substr(sep_pos + 1);
-
-         if(DEBUG_OUTPUT) std::cout << "querry type: " << querry_type << " for word: " << word; // <---- print command
+    // Reading, executing and writing run in three stages at the same time, see QueryPipeline.hpp.
+    // With -latency every querry is timed, with -latency=N every N-th one.
+    std::unique_ptr<LatencyRecorder> latency;
+    if (latency_sample_rate > 0) latency = std::make_unique<LatencyRecorder>(latency_sample_rate);
 
-        if (querry_type == "c")         result = trie->contains(word);
-        else if (querry_type == "d")    result = trie->delete_elem(word);
-        else if (querry_type == "i")    result = trie->insert(word);
-        else throw std::invalid_argument("Unsupported querry type: " + querry_type);
-
-         if(DEBUG_OUTPUT) std::cout << " - result: " << result << std::endl; // <---- print command
-        
-        if (result)
-        {
-            output << "true" << std::endl; 
-        } else {
-            output << "false" << std::endl;
-        }
-        
-    }
+    // With -sorted, every run of c querries between two other querries is looked up in sorted order, so that
+    // words with a common prefix share their walk.
+    QueryPipeline pipeline(querry, output, DEBUG_OUTPUT, latency.get(), sorted_runs);
+    with_trie_class(*trie, [&](auto& concrete_trie) { pipeline.run(concrete_trie); });
 
     end = std::chrono::high_resolution_clock::now(); // end timer
     querry_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    size_t querry_rss = current_rss_bytes();
+    size_t querry_peak = peak_rss_bytes();
 
     // Making the output
 
@@ -147,10 +322,20 @@ int main(int argc, char* argv[]) {
             << " trie_variant=" << trie_variant
             << " trie_construction_time=" << trie_contruction_time << "ms"
             << " trie_construction_memory=" << trie_construction_memory << "MiB"
-            << " querry_time=" << querry_time << "ms" << std::endl;
+            << " querry_time=" << querry_time << "ms";
+    if (latency) latency->print(std::cout);
+    std::cout << std::endl;
+
+    std::cout << "MEMORY"
+            << " startup_rss=" << startup_rss / byte_mebiByte_conversion_rate << "MiB"
+            << " startup_peak=" << startup_peak / byte_mebiByte_conversion_rate << "MiB"
+            << " construction_rss=" << construction_rss / byte_mebiByte_conversion_rate << "MiB"
+            << " construction_peak=" << construction_peak / byte_mebiByte_conversion_rate << "MiB"
+            << " querry_rss=" << querry_rss / byte_mebiByte_conversion_rate << "MiB"
+            << " querry_peak=" << querry_peak / byte_mebiByte_conversion_rate << "MiB" << std::endl;
+
+    if (trie->prefix_filter() != nullptr) trie->prefix_filter()->print(std::cout);
 
-    input.close();
-    querry.close();
     output.close();
     
     return 0;